@@ -63,6 +63,8 @@ public:
 
     virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
 
+    virtual QStringList formatsToLoad() const { return formatsToSave(); }
+
     virtual QString id() const { return "itemdata"; }
     virtual QString name() const { return tr("&Data Items"); }
     virtual QString author() const { return QString(); }
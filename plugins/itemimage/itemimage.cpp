@@ -18,19 +18,32 @@
 */
 
 #include "itemimage.h"
+#include "thumbnailcache.h"
 #include "ui_itemimagesettings.h"
 
 #include "common/contenttype.h"
 #include "item/itemeditor.h"
 
+#include <QBuffer>
+#include <QCoreApplication>
 #include <QHBoxLayout>
+#include <QImageReader>
 #include <QModelIndex>
 #include <QPixmap>
+#include <QRegExp>
+#include <QSettings>
+#include <QThreadPool>
 #include <QtPlugin>
 #include <QVariant>
 
 namespace {
 
+// Images with more data are decoded in worker thread.
+const int asyncDecodeMinBytes = 32*1024;
+
+// Default size limit for thumbnails on disk in MiB.
+const int defaultThumbnailCacheMiB = 50;
+
 const QStringList imageFormats =
         QStringList("image/svg+xml") << QString("image/png") << QString("image/bmp")
                                      << QString("image/jpeg") << QString("image/gif");
@@ -60,20 +73,113 @@ bool getImageData(const QModelIndex &index, QByteArray *data, QString *mime)
     return true;
 }
 
-bool getPixmapFromData(const QModelIndex &index, QPixmap *pix)
+/**
+ * Return size of image scaled down to fit into @a maxWidth and @a maxHeight
+ * (non-positive value means no limit).
+ */
+QSize scaledImageSize(const QSize &size, int maxWidth, int maxHeight)
 {
-    QString mime;
-    QByteArray data;
-    if ( !getImageData(index, &data, &mime) )
-        return false;
+    const int w = size.width();
+    const int h = size.height();
+    if (w <= 0 || h <= 0)
+        return size;
 
-    pix->loadFromData( data, mime.toLatin1() );
+    if ( maxWidth > 0 && w > maxWidth && (maxHeight <= 0 || w/maxWidth > h/maxHeight) )
+        return QSize( maxWidth, qMax(1, h * maxWidth / w) );
 
-    return true;
+    if (maxHeight > 0 && h > maxHeight)
+        return QSize( qMax(1, w * maxHeight / h), maxHeight );
+
+    return size;
+}
+
+/** Return image format for QImageReader from MIME type (e.g. "png" for "image/png"). */
+QByteArray imageFormat(const QString &mime)
+{
+    QByteArray format = mime.mid( mime.indexOf('/') + 1 ).toLatin1();
+    if ( format.endsWith("+xml") )
+        format.chop(4);
+    return format;
+}
+
+/**
+ * Decode image from @a data in given @a format.
+ *
+ * If @a size is valid, image is decoded directly at given size (this is much
+ * faster and uses less memory for some formats, e.g. JPEG and SVG).
+ */
+QImage readImage(const QByteArray &data, const QByteArray &format, const QSize &size)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer, format);
+    if ( size.isValid() )
+        reader.setScaledSize(size);
+
+    return reader.read();
+}
+
+/** Return size of image without decoding it or invalid size if it's unknown. */
+QSize readImageSize(const QByteArray &data, const QByteArray &format)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    return QImageReader(&buffer, format).size();
+}
+
+QString thumbnailCachePath()
+{
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope,
+                       QCoreApplication::organizationName(),
+                       QCoreApplication::applicationName());
+    // .ini -> _thumbnails
+    QString path = settings.fileName();
+    path.replace( QRegExp("\\.ini$"), QString("_thumbnails") );
+    return path;
+}
+
+qint64 thumbnailCacheBytes(const QVariantMap &settings)
+{
+    return settings.value("thumbnail_cache_mb", defaultThumbnailCacheMiB).toLongLong() * 1024 * 1024;
 }
 
 } // namespace
 
+ItemImageDecodeJob::ItemImageDecodeJob(
+        const QByteArray &data, const QByteArray &format, const QSize &size,
+        const ThumbnailCachePtr &cache)
+    : QObject()
+    , QRunnable()
+    , m_data(data)
+    , m_format(format)
+    , m_size(size)
+    , m_cache(cache)
+{
+    setAutoDelete(false);
+}
+
+void ItemImageDecodeJob::run()
+{
+    QImage image;
+
+    if ( m_cache.isNull() ) {
+        image = readImage(m_data, m_format, m_size);
+    } else {
+        const QString key = ThumbnailCache::key(m_data, m_size);
+        if ( !m_cache->load(key, &image) ) {
+            image = readImage(m_data, m_format, m_size);
+            m_cache->save(key, image);
+        }
+    }
+
+    emit finished(image);
+    deleteLater();
+}
+
 ItemImage::ItemImage(const QPixmap &pix, const QString &imageEditor, const QString &svgEditor,
                      QWidget *parent)
     : QLabel(parent)
@@ -98,6 +204,15 @@ QObject *ItemImage::createExternalEditor(const QModelIndex &index, QWidget *pare
     return cmd.isEmpty() ? NULL : new ItemEditor(data, mime, cmd, parent);
 }
 
+void ItemImage::setImage(const QImage &image)
+{
+    if ( image.isNull() )
+        setText( tr("Cannot load image") );
+    else
+        setPixmap( QPixmap::fromImage(image) );
+    updateSize();
+}
+
 void ItemImage::updateSize()
 {
     adjustSize();
@@ -105,6 +220,7 @@ void ItemImage::updateSize()
 
 ItemImageLoader::ItemImageLoader()
     : ui(NULL)
+    , m_thumbnailCache()
 {
 }
 
@@ -115,22 +231,49 @@ ItemImageLoader::~ItemImageLoader()
 
 ItemWidget *ItemImageLoader::create(const QModelIndex &index, QWidget *parent) const
 {
-    // TODO: Just check if image provided and load it in different thread.
-    QPixmap pix;
-    if ( !getPixmapFromData(index, &pix) )
+    QString mime;
+    QByteArray data;
+    if ( !getImageData(index, &data, &mime) )
         return NULL;
 
-    // scale pixmap
     const int w = m_settings.value("max_image_width", 320).toInt();
     const int h = m_settings.value("max_image_height", 240).toInt();
-    if ( w > 0 && pix.width() > w && (h <= 0 || pix.width()/w > pix.height()/h) ) {
-        pix = pix.scaledToWidth(w);
-    } else if (h > 0 && pix.height() > h) {
-        pix = pix.scaledToHeight(h);
+    const QString imageEditor = m_settings.value("image_editor").toString();
+    const QString svgEditor = m_settings.value("svg_editor").toString();
+
+    const QByteArray format = imageFormat(mime);
+
+    // Image size is read from header without decoding the image.
+    const QSize size = scaledImageSize( readImageSize(data, format), w, h );
+
+    if ( data.size() < asyncDecodeMinBytes || !size.isValid() ) {
+        ItemImage *item = new ItemImage(QPixmap(), imageEditor, svgEditor, parent);
+        item->setImage( readImage(data, format, size) );
+        return item;
     }
 
-    return new ItemImage(pix, m_settings.value("image_editor").toString(),
-                         m_settings.value("svg_editor").toString(), parent);
+    // Show empty placeholder with final size until image is decoded in worker thread.
+    QPixmap placeholder(size);
+    placeholder.fill(Qt::transparent);
+    ItemImage *item = new ItemImage(placeholder, imageEditor, svgEditor, parent);
+
+    ItemImageDecodeJob *job = new ItemImageDecodeJob(data, format, size, m_thumbnailCache);
+    connect( job, SIGNAL(finished(QImage)),
+             item, SLOT(setImage(QImage)), Qt::QueuedConnection );
+    QThreadPool::globalInstance()->start(job);
+
+    return item;
+}
+
+void ItemImageLoader::loadSettings(const QVariantMap &settings)
+{
+    m_settings = settings;
+
+    const qint64 cacheBytes = thumbnailCacheBytes(m_settings);
+    if ( m_thumbnailCache.isNull() )
+        m_thumbnailCache = ThumbnailCachePtr( new ThumbnailCache(thumbnailCachePath(), cacheBytes) );
+    else
+        m_thumbnailCache->setMaximumBytes(cacheBytes);
 }
 
 QStringList ItemImageLoader::formatsToSave() const
@@ -22,12 +22,46 @@
 
 #include "item/itemwidget.h"
 
+#include <QImage>
 #include <QLabel>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QSize>
+
+class ThumbnailCache;
 
 namespace Ui {
 class ItemImageSettings;
 }
 
+typedef QSharedPointer<ThumbnailCache> ThumbnailCachePtr;
+
+/**
+ * Decodes image data to given size in worker thread.
+ *
+ * Decoded thumbnail is loaded from and stored in thumbnail cache (if not NULL).
+ * Null image is passed to finished() signal if decoding fails.
+ */
+class ItemImageDecodeJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    ItemImageDecodeJob(const QByteArray &data, const QByteArray &format, const QSize &size,
+                       const ThumbnailCachePtr &cache);
+
+    void run();
+
+signals:
+    void finished(const QImage &image);
+
+private:
+    QByteArray m_data;
+    QByteArray m_format;
+    QSize m_size;
+    ThumbnailCachePtr m_cache;
+};
+
 class ItemImage : public QLabel, public ItemWidget
 {
     Q_OBJECT
@@ -38,6 +72,10 @@ public:
 
     virtual QObject *createExternalEditor(const QModelIndex &index, QWidget *parent) const;
 
+public slots:
+    /** Replace placeholder with decoded image (show error if @a image is null). */
+    void setImage(const QImage &image);
+
 protected:
     virtual void updateSize();
 
@@ -59,6 +97,8 @@ public:
 
     virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
 
+    virtual QStringList formatsToLoad() const { return formatsToSave(); }
+
     virtual int priority() const { return 10; }
 
     virtual QString id() const { return "itemimage"; }
@@ -70,13 +110,14 @@ public:
 
     virtual QVariantMap applySettings();
 
-    virtual void loadSettings(const QVariantMap &settings) { m_settings = settings; }
+    virtual void loadSettings(const QVariantMap &settings);
 
     virtual QWidget *createSettingsWidget(QWidget *parent);
 
 private:
     QVariantMap m_settings;
     Ui::ItemImageSettings *ui;
+    ThumbnailCachePtr m_thumbnailCache;
 };
 
 #endif // ITEMIMAGE_H
@@ -1,7 +1,9 @@
 include(../plugins_common.pri)
 
-HEADERS += itemimage.h
-SOURCES += itemimage.cpp
+HEADERS += itemimage.h \
+           thumbnailcache.h
+SOURCES += itemimage.cpp \
+           thumbnailcache.cpp
 FORMS   += itemimagesettings.ui
 TARGET   = $$qtLibraryTarget(itemimage)
 
@@ -0,0 +1,232 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "thumbnailcache.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QMutexLocker>
+#include <QSize>
+#include <QTemporaryFile>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char fileSuffix[] = ".thumb";
+const quint32 fileMagic = 0x43515431; // "CQT1"
+
+/** Header of thumbnail file followed by raw image data. */
+struct ThumbnailHeader {
+    quint32 magic;
+    qint32 width;
+    qint32 height;
+    qint32 bytesPerLine;
+};
+
+qint64 now()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+bool lessRecentlyUsed(const QPair<qint64, QString> &lhs, const QPair<qint64, QString> &rhs)
+{
+    return lhs.first < rhs.first;
+}
+
+} // namespace
+
+ThumbnailCache::ThumbnailCache(const QString &path, qint64 maximumBytes)
+    : m_mutex()
+    , m_path(path)
+    , m_maximumBytes(maximumBytes)
+    , m_totalBytes(0)
+    , m_entries()
+    , m_indexLoaded(false)
+{
+}
+
+void ThumbnailCache::setMaximumBytes(qint64 maximumBytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_maximumBytes = maximumBytes;
+    if (m_indexLoaded)
+        evict();
+}
+
+QString ThumbnailCache::key(const QByteArray &data, const QSize &size)
+{
+    const QByteArray hash = QCryptographicHash::hash(data, QCryptographicHash::Md5).toHex();
+    return QString("%1_%2x%3")
+            .arg( QString::fromLatin1(hash) )
+            .arg( size.width() )
+            .arg( size.height() );
+}
+
+bool ThumbnailCache::load(const QString &key, QImage *image)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_maximumBytes <= 0)
+            return false;
+
+        loadIndex();
+
+        QHash<QString, Entry>::iterator it = m_entries.find(key);
+        if ( it == m_entries.end() )
+            return false;
+        it->lastUsed = now();
+    }
+
+    QFile file( fileName(key) );
+    bool ok = file.open(QIODevice::ReadOnly);
+
+    if (ok) {
+        const qint64 fileSize = file.size();
+        const uchar *bytes = fileSize >= qint64(sizeof(ThumbnailHeader)) ? file.map(0, fileSize) : NULL;
+
+        ThumbnailHeader header;
+        ok = bytes != NULL;
+        if (ok) {
+            memcpy( &header, bytes, sizeof(header) );
+            ok = header.magic == fileMagic
+                    && header.width > 0 && header.height > 0
+                    && fileSize == qint64(sizeof(header))
+                                   + qint64(header.bytesPerLine) * header.height;
+        }
+
+        // Deep copy since mapped memory is released with the file.
+        if (ok) {
+            *image = QImage( bytes + sizeof(header), header.width, header.height,
+                             header.bytesPerLine, QImage::Format_ARGB32_Premultiplied ).copy();
+        }
+    }
+
+    if (!ok) {
+        QMutexLocker lock(&m_mutex);
+        QHash<QString, Entry>::iterator it = m_entries.find(key);
+        if ( it != m_entries.end() ) {
+            m_totalBytes -= it->bytes;
+            m_entries.erase(it);
+        }
+        file.remove();
+    }
+
+    return ok;
+}
+
+void ThumbnailCache::save(const QString &key, const QImage &image)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_maximumBytes <= 0 || image.isNull())
+            return;
+        loadIndex();
+        if ( m_entries.contains(key) )
+            return;
+    }
+
+    const QImage img = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    ThumbnailHeader header;
+    header.magic = fileMagic;
+    header.width = img.width();
+    header.height = img.height();
+    header.bytesPerLine = img.bytesPerLine();
+
+    // Write to temporary file first so other threads never see incomplete thumbnail.
+    QTemporaryFile file(m_path + "/XXXXXX.tmp");
+    if ( !file.open() )
+        return;
+
+    const qint64 bytes = img.byteCount();
+    if ( file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header)
+         || file.write(reinterpret_cast<const char *>(img.constBits()), bytes) != bytes )
+    {
+        return;
+    }
+
+    const QString target = fileName(key);
+    QFile::remove(target);
+    if ( !file.rename(target) )
+        return;
+    file.setAutoRemove(false);
+
+    QMutexLocker lock(&m_mutex);
+    if ( m_entries.contains(key) )
+        return;
+    Entry &entry = m_entries[key];
+    entry.bytes = sizeof(header) + bytes;
+    entry.lastUsed = now();
+    m_totalBytes += entry.bytes;
+    evict();
+}
+
+QString ThumbnailCache::fileName(const QString &key) const
+{
+    return m_path + '/' + key + fileSuffix;
+}
+
+void ThumbnailCache::loadIndex()
+{
+    if (m_indexLoaded)
+        return;
+    m_indexLoaded = true;
+
+    QDir dir(m_path);
+    if ( !dir.exists() && !dir.mkpath(".") )
+        return;
+
+    const QFileInfoList files =
+            dir.entryInfoList(QStringList(QString("*") + fileSuffix), QDir::Files);
+    foreach (const QFileInfo &info, files) {
+        Entry &entry = m_entries[info.completeBaseName()];
+        entry.bytes = info.size();
+        entry.lastUsed = info.lastModified().toMSecsSinceEpoch();
+        m_totalBytes += entry.bytes;
+    }
+
+    evict();
+}
+
+void ThumbnailCache::evict()
+{
+    if (m_totalBytes <= m_maximumBytes)
+        return;
+
+    QList< QPair<qint64, QString> > entries;
+    for ( QHash<QString, Entry>::const_iterator it = m_entries.constBegin();
+          it != m_entries.constEnd(); ++it )
+    {
+        entries.append( qMakePair(it->lastUsed, it.key()) );
+    }
+    std::sort( entries.begin(), entries.end(), lessRecentlyUsed );
+
+    for (int i = 0; i < entries.size() && m_totalBytes > m_maximumBytes; ++i) {
+        const QString &key = entries[i].second;
+        m_totalBytes -= m_entries.take(key).bytes;
+        QFile::remove( fileName(key) );
+    }
+}
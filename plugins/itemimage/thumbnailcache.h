@@ -0,0 +1,86 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef THUMBNAILCACHE_H
+#define THUMBNAILCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+class QByteArray;
+class QImage;
+class QSize;
+
+/**
+ * Thumbnails of decoded images stored on disk.
+ *
+ * Thumbnails are saved as raw image data so loading them is just a matter of
+ * mapping file to memory. Thumbnails are identified by hash of original image
+ * data and thumbnail size.
+ *
+ * If total size of files exceeds limit, least recently used thumbnails are
+ * removed. Order of use is tracked in memory only; modification time of files
+ * is used after restart.
+ *
+ * All methods are thread-safe.
+ */
+class ThumbnailCache
+{
+public:
+    /**
+     * Cache thumbnails in directory @a path with total size at most
+     * @a maximumBytes (non-positive value disables the cache).
+     */
+    ThumbnailCache(const QString &path, qint64 maximumBytes);
+
+    void setMaximumBytes(qint64 maximumBytes);
+
+    /** Return key for thumbnail of given size created from image @a data. */
+    static QString key(const QByteArray &data, const QSize &size);
+
+    /** Load thumbnail, return false if it's not cached. */
+    bool load(const QString &key, QImage *image);
+
+    /** Save thumbnail (remove least recently used thumbnails if cache is full). */
+    void save(const QString &key, const QImage &image);
+
+private:
+    struct Entry {
+        qint64 bytes;
+        qint64 lastUsed;
+    };
+
+    QString fileName(const QString &key) const;
+
+    /** Read existing thumbnail files (called with m_mutex locked). */
+    void loadIndex();
+
+    /** Remove least recently used thumbnails (called with m_mutex locked). */
+    void evict();
+
+    QMutex m_mutex;
+    QString m_path;
+    qint64 m_maximumBytes;
+    qint64 m_totalBytes;
+    QHash<QString, Entry> m_entries;
+    bool m_indexLoaded;
+};
+
+#endif // THUMBNAILCACHE_H
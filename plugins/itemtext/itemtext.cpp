@@ -27,6 +27,10 @@
 #include <QMouseEvent>
 #include <QTextCursor>
 #include <QTextDocument>
+#include <QTextDocumentFragment>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
 #include <QtPlugin>
 
 namespace {
@@ -34,12 +38,25 @@ namespace {
 // Limit number of characters for performance reasons.
 const int defaultMaxBytes = 100*1024;
 
+// Texts longer than this are parsed and laid out in worker thread.
+const int asyncLayoutMinBytes = 4*1024;
+
+// Number of characters shown until document is laid out in worker thread.
+const int previewMaxBytes = 1024;
+
 void init(QTextDocument &doc, const QFont &font)
 {
     doc.setDefaultFont(font);
     doc.setUndoRedoEnabled(false);
 }
 
+TextDocumentPtr newTextDocument(const QFont &font)
+{
+    TextDocumentPtr doc(new QTextDocument, &QObject::deleteLater);
+    init(*doc, font);
+    return doc;
+}
+
 bool getRichText(const QModelIndex &index, const QStringList &formats, QString *text)
 {
     if ( index.data(contentType::hasHtml).toBool() ) {
@@ -72,14 +89,51 @@ bool getText(const QModelIndex &index, QString *text)
 
 } // namespace
 
+ItemTextLayoutJob::ItemTextLayoutJob(
+        const QString &text, Qt::TextFormat format, const QFont &font, int width)
+    : QObject()
+    , QRunnable()
+    , m_text(text)
+    , m_textFormat(format)
+    , m_font(font)
+    , m_width(width)
+{
+    setAutoDelete(false);
+}
+
+void ItemTextLayoutJob::run()
+{
+    TextDocumentPtr doc = newTextDocument(m_font);
+
+    if (m_textFormat == Qt::RichText)
+        doc->setHtml(m_text);
+    else
+        doc->setPlainText(m_text);
+
+    // Force layout of whole document.
+    doc->setTextWidth(m_width);
+    doc->size();
+
+    // Let the receiver own the document.
+    doc->moveToThread( thread() );
+
+    emit finished(doc, m_width);
+    deleteLater();
+}
+
 ItemText::ItemText(const QString &text, bool isRichText, QWidget *parent)
     : QTextEdit(parent)
     , ItemWidget(this)
-    , m_textDocument()
+    , m_textDocument( newTextDocument(font()) )
     , m_searchTextDocument()
     , m_textFormat(isRichText ? Qt::RichText : Qt::PlainText)
+    , m_text()
+    , m_layoutWidth(-1)
+    , m_jobWidth(-1)
+    , m_highlightRe()
+    , m_highlightFont()
+    , m_highlightPalette()
 {
-    init(m_textDocument, font());
     init(m_searchTextDocument, font());
 
     setUndoRedoEnabled(false);
@@ -93,22 +147,35 @@ ItemText::ItemText(const QString &text, bool isRichText, QWidget *parent)
 
     setReadOnly(true);
 
-    if (isRichText)
-        m_textDocument.setHtml( text.left(defaultMaxBytes) );
-    else
-        m_textDocument.setPlainText( text.left(defaultMaxBytes) );
-    setDocument(&m_textDocument);
+    if (text.size() > asyncLayoutMinBytes) {
+        // Show only beginning of text as plain text until whole document is
+        // ready (layout is started as soon as maximum width is known).
+        m_text = text.left(defaultMaxBytes);
+        const QString preview = text.left(previewMaxBytes);
+        m_textDocument->setPlainText( isRichText
+                                      ? QTextDocumentFragment::fromHtml(preview).toPlainText()
+                                      : preview );
+    } else if (isRichText) {
+        m_textDocument->setHtml(text);
+    } else {
+        m_textDocument->setPlainText(text);
+    }
+    setDocument( m_textDocument.data() );
     updateSize();
 }
 
 void ItemText::highlight(const QRegExp &re, const QFont &highlightFont, const QPalette &highlightPalette)
 {
+    m_highlightRe = re;
+    m_highlightFont = highlightFont;
+    m_highlightPalette = highlightPalette;
+
     m_searchTextDocument.clear();
     if ( re.isEmpty() ) {
-        setDocument(&m_textDocument);
+        setDocument( m_textDocument.data() );
     } else {
         bool plain = m_textFormat == Qt::PlainText;
-        const QString &text = plain ? m_textDocument.toPlainText() : m_textDocument.toHtml();
+        const QString &text = plain ? m_textDocument->toPlainText() : m_textDocument->toHtml();
         if (plain)
             m_searchTextDocument.setPlainText(text);
         else
@@ -145,9 +212,16 @@ void ItemText::highlight(const QRegExp &re, const QFont &highlightFont, const QP
 void ItemText::updateSize()
 {
     const int w = maximumWidth();
+
+    // Postpone layout since maximum width usually changes right after item is created.
+    if ( !m_text.isNull() && w != m_layoutWidth ) {
+        m_layoutWidth = w;
+        QTimer::singleShot( 0, this, SLOT(startLayout()) );
+    }
+
     m_searchTextDocument.setTextWidth(w);
-    m_textDocument.setTextWidth(w);
-    resize( m_textDocument.idealWidth() + 16, m_textDocument.size().height() );
+    m_textDocument->setTextWidth(w);
+    resize( m_textDocument->idealWidth() + 16, m_textDocument->size().height() );
 }
 
 void ItemText::mousePressEvent(QMouseEvent *e)
@@ -186,9 +260,38 @@ void ItemText::onSelectionChanged()
     setProperty("copyOnMouseUp", true);
 }
 
+void ItemText::onLayoutFinished(const TextDocumentPtr &document, int width)
+{
+    // Drop result if item width changed in the meantime (newer job is running).
+    if ( m_text.isNull() || width != m_layoutWidth )
+        return;
+
+    m_text = QString();
+    m_textDocument = document;
+    setDocument( m_textDocument.data() );
+
+    if ( !m_highlightRe.isEmpty() )
+        highlight(m_highlightRe, m_highlightFont, m_highlightPalette);
+    updateSize();
+}
+
+void ItemText::startLayout()
+{
+    if ( m_text.isNull() || m_jobWidth == m_layoutWidth )
+        return;
+
+    m_jobWidth = m_layoutWidth;
+
+    ItemTextLayoutJob *job = new ItemTextLayoutJob(m_text, m_textFormat, font(), m_jobWidth);
+    connect( job, SIGNAL(finished(TextDocumentPtr,int)),
+             this, SLOT(onLayoutFinished(TextDocumentPtr,int)), Qt::QueuedConnection );
+    QThreadPool::globalInstance()->start(job);
+}
+
 ItemTextLoader::ItemTextLoader()
     : ui(NULL)
 {
+    qRegisterMetaType<TextDocumentPtr>("TextDocumentPtr");
 }
 
 ItemTextLoader::~ItemTextLoader()
@@ -22,6 +22,10 @@
 
 #include "item/itemwidget.h"
 
+#include <QFont>
+#include <QPalette>
+#include <QRunnable>
+#include <QSharedPointer>
 #include <QTextDocument>
 #include <QTextEdit>
 
@@ -29,6 +33,34 @@ namespace Ui {
 class ItemTextSettings;
 }
 
+/** Text document shared between layout thread and item (deleted using QObject::deleteLater()). */
+typedef QSharedPointer<QTextDocument> TextDocumentPtr;
+
+/**
+ * Creates and lays out text document in worker thread.
+ *
+ * Finished document is moved to the thread in which the job was created and
+ * passed to the item using finished() signal.
+ */
+class ItemTextLayoutJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    ItemTextLayoutJob(const QString &text, Qt::TextFormat format, const QFont &font, int width);
+
+    void run();
+
+signals:
+    void finished(const TextDocumentPtr &document, int width);
+
+private:
+    QString m_text;
+    Qt::TextFormat m_textFormat;
+    QFont m_font;
+    int m_width;
+};
+
 class ItemText : public QTextEdit, public ItemWidget
 {
     Q_OBJECT
@@ -57,12 +89,31 @@ protected:
 private slots:
     void onSelectionChanged();
 
+    /** Use document laid out in worker thread. */
+    void onLayoutFinished(const TextDocumentPtr &document, int width);
+
+    /** Start laying out text document in worker thread for current width. */
+    void startLayout();
+
 private:
-    QTextDocument m_textDocument;
+    TextDocumentPtr m_textDocument;
     QTextDocument m_searchTextDocument;
     Qt::TextFormat m_textFormat;
+
+    /** Full text if document is still being laid out in worker thread, otherwise null. */
+    QString m_text;
+    /** Width for which document should be laid out. */
+    int m_layoutWidth;
+    /** Width of document being laid out in worker thread. */
+    int m_jobWidth;
+
+    QRegExp m_highlightRe;
+    QFont m_highlightFont;
+    QPalette m_highlightPalette;
 };
 
+Q_DECLARE_METATYPE(TextDocumentPtr)
+
 class ItemTextLoader : public QObject, public ItemLoaderInterface
 {
     Q_OBJECT
@@ -76,6 +127,8 @@ public:
 
     virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
 
+    virtual QStringList formatsToLoad() const { return formatsToSave(); }
+
     virtual QString id() const { return "itemtext"; }
     virtual QString name() const { return tr("Te&xt Items"); }
     virtual QString author() const { return QString(); }
@@ -23,9 +23,12 @@
 
 #include <QApplication>
 #include <QDesktopWidget>
+#include <QDynamicPropertyChangeEvent>
 #include <QModelIndex>
 #include <QMouseEvent>
+#include <QPainter>
 #include <QPalette>
+#include <QTimer>
 #include <QtPlugin>
 #include <QtWebKit/QWebHistory>
 #if QT_VERSION < 0x050000
@@ -39,6 +42,44 @@
 
 namespace {
 
+// Maximum size of cached snapshots in KiB.
+const int snapshotCacheKiB = 32 * 1024;
+
+void initPage(QWebPage *page, const QFont &defaultFont)
+{
+    QWebFrame *frame = page->mainFrame();
+    frame->setScrollBarPolicy(Qt::Horizontal, Qt::ScrollBarAlwaysOff);
+    frame->setScrollBarPolicy(Qt::Vertical,   Qt::ScrollBarAlwaysOff);
+
+    QWebSettings *settings = page->settings();
+    settings->setFontFamily(QWebSettings::StandardFont, defaultFont.family());
+    // DPI resolution can be different than the one used by this widget.
+    QWidget* window = QApplication::desktop()->screen();
+    int dpi = window->logicalDpiX();
+    int pt = defaultFont.pointSize();
+    settings->setFontSize(QWebSettings::DefaultFontSize, pt * dpi / 72);
+
+    page->history()->setMaximumItemCount(0);
+}
+
+void findText(QWebPage *page, const QString &text)
+{
+    // FIXME: Set hightlight color and font!
+    // FIXME: Hightlight text matching regular expression!
+    page->findText( QString(), QWebPage::HighlightAllOccurrences );
+
+    if ( !text.isEmpty() )
+        page->findText( text, QWebPage::HighlightAllOccurrences );
+}
+
+QSize layoutPage(QWebPage *page, int width)
+{
+    page->setPreferredContentsSize( QSize(width, 10) );
+    QSize size( width, page->mainFrame()->contentsSize().height() );
+    page->setViewportSize(size);
+    return size;
+}
+
 bool getHtml(const QModelIndex &index, QString *text)
 {
     *text = index.data(contentType::html).toString();
@@ -59,18 +100,7 @@ ItemWeb::ItemWeb(const QString &html, QWidget *parent)
     , ItemWidget(this)
 {
     QWebFrame *frame = page()->mainFrame();
-    frame->setScrollBarPolicy(Qt::Horizontal, Qt::ScrollBarAlwaysOff);
-    frame->setScrollBarPolicy(Qt::Vertical,   Qt::ScrollBarAlwaysOff);
-
-    const QFont &defaultFont = font();
-    settings()->setFontFamily(QWebSettings::StandardFont, defaultFont.family());
-    // DPI resolution can be different than the one used by this widget.
-    QWidget* window = QApplication::desktop()->screen();
-    int dpi = window->logicalDpiX();
-    int pt = defaultFont.pointSize();
-    settings()->setFontSize(QWebSettings::DefaultFontSize, pt * dpi / 72);
-
-    history()->setMaximumItemCount(0);
+    initPage( page(), font() );
 
     QPalette pal(palette());
     pal.setBrush(QPalette::Base, Qt::transparent);
@@ -96,12 +126,7 @@ ItemWeb::ItemWeb(const QString &html, QWidget *parent)
 
 void ItemWeb::highlight(const QRegExp &re, const QFont &, const QPalette &)
 {
-    // FIXME: Set hightlight color and font!
-    // FIXME: Hightlight text matching regular expression!
-    findText( QString(), QWebPage::HighlightAllOccurrences );
-
-    if ( !re.isEmpty() )
-        findText( re.pattern(), QWebPage::HighlightAllOccurrences );
+    findText( page(), re.pattern() );
 }
 
 void ItemWeb::onItemChanged()
@@ -111,11 +136,7 @@ void ItemWeb::onItemChanged()
 
 void ItemWeb::updateSize()
 {
-    const int w = maximumWidth();
-    page()->setPreferredContentsSize( QSize(w, 10) );
-    QSize size( w, page()->mainFrame()->contentsSize().height() );
-    page()->setViewportSize(size);
-    resize(size);
+    resize( layoutPage(page(), maximumWidth()) );
 }
 
 void ItemWeb::onSelectionChanged()
@@ -162,13 +183,245 @@ void ItemWeb::mouseReleaseEvent(QMouseEvent *e)
     }
 }
 
+ItemWebSnapshot::ItemWebSnapshot(const QString &html, ItemWebRenderer *renderer, QWidget *parent)
+    : QWidget(parent)
+    , ItemWidget(this)
+    , m_html(html)
+    , m_renderer(renderer)
+    , m_pixmap()
+    , m_liveView(NULL)
+    , m_re()
+    , m_highlightFont()
+    , m_highlightPalette()
+{
+    updateSize();
+}
+
+void ItemWebSnapshot::setSnapshot(const QPixmap &pixmap)
+{
+    m_pixmap = pixmap;
+    updateSize();
+    update();
+}
+
+void ItemWebSnapshot::setLive(bool live)
+{
+    if ( live == (m_liveView != NULL) )
+        return;
+
+    if (live) {
+        m_liveView = new ItemWeb(m_html, this);
+        m_liveView->setMaximumSize( maximumSize() );
+        m_liveView->setMinimumWidth( minimumWidth() );
+        m_liveView->setHighlight(m_re, m_highlightFont, m_highlightPalette);
+        m_liveView->installEventFilter(this);
+        m_liveView->show();
+
+        if ( !m_renderer.isNull() )
+            m_renderer->setLiveItem(this);
+    } else {
+        m_liveView->hide();
+        m_liveView->deleteLater();
+        m_liveView = NULL;
+    }
+
+    updateSize();
+    update();
+}
+
+void ItemWebSnapshot::updateSize()
+{
+    const int w = maximumWidth();
+
+    if (m_liveView != NULL) {
+        m_liveView->setMaximumSize( maximumSize() );
+        m_liveView->setMinimumWidth( minimumWidth() );
+        static_cast<ItemWidget *>(m_liveView)->updateSize();
+        resize( m_liveView->size() );
+        return;
+    }
+
+    if ( w > 0 && m_pixmap.width() != w )
+        requestSnapshot();
+
+    // Keep old height until new snapshot is rendered.
+    resize( w, m_pixmap.isNull() ? fontMetrics().lineSpacing() : m_pixmap.height() );
+}
+
+void ItemWebSnapshot::highlight(const QRegExp &re, const QFont &highlightFont,
+                                const QPalette &highlightPalette)
+{
+    m_re = re;
+    m_highlightFont = highlightFont;
+    m_highlightPalette = highlightPalette;
+
+    if (m_liveView != NULL)
+        m_liveView->setHighlight(re, highlightFont, highlightPalette);
+
+    requestSnapshot();
+}
+
+bool ItemWebSnapshot::event(QEvent *event)
+{
+    // Create live view for selected item only.
+    if ( event->type() == QEvent::DynamicPropertyChange ) {
+        const QByteArray name = static_cast<QDynamicPropertyChangeEvent *>(event)->propertyName();
+        if (name == "CopyQ_selected")
+            setLive( property(name).toBool() );
+    }
+
+    return QWidget::event(event);
+}
+
+bool ItemWebSnapshot::eventFilter(QObject *object, QEvent *event)
+{
+    if ( object == m_liveView && event->type() == QEvent::Resize )
+        resize( m_liveView->size() );
+
+    return QWidget::eventFilter(object, event);
+}
+
+void ItemWebSnapshot::paintEvent(QPaintEvent *)
+{
+    if ( m_liveView != NULL || m_pixmap.isNull() )
+        return;
+
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, m_pixmap);
+}
+
+void ItemWebSnapshot::requestSnapshot()
+{
+    if ( !m_renderer.isNull() )
+        m_renderer->render( this, maximumWidth(), m_re.pattern() );
+}
+
+ItemWebRenderer::ItemWebRenderer(QObject *parent)
+    : QObject(parent)
+    , m_page(NULL)
+    , m_requests()
+    , m_current()
+    , m_loading(false)
+    , m_cache(snapshotCacheKiB)
+    , m_liveItem()
+{
+}
+
+void ItemWebRenderer::render(ItemWebSnapshot *item, int width, const QString &highlight)
+{
+    // Drop older request for the item.
+    for (int i = m_requests.size() - 1; i >= 0; --i) {
+        if (m_requests[i].item == item)
+            m_requests.removeAt(i);
+    }
+
+    Request request;
+    request.item = item;
+    request.width = width;
+    request.highlight = highlight;
+    request.key = QString("%1:%2:%3:%4")
+            .arg( qHash(item->html()) )
+            .arg( item->html().size() )
+            .arg(width)
+            .arg(highlight);
+
+    const QPixmap *pixmap = m_cache.object(request.key);
+    if (pixmap != NULL) {
+        item->setSnapshot(*pixmap);
+        return;
+    }
+
+    m_requests.append(request);
+
+    // Render later so multiple requests for the same item are merged.
+    QTimer::singleShot( 0, this, SLOT(renderNext()) );
+}
+
+void ItemWebRenderer::setLiveItem(ItemWebSnapshot *item)
+{
+    if (m_liveItem == item)
+        return;
+
+    ItemWebSnapshot *oldItem = m_liveItem;
+    m_liveItem = item;
+    if (oldItem != NULL)
+        oldItem->setLive(false);
+}
+
+void ItemWebRenderer::onLoadFinished()
+{
+    m_loading = false;
+
+    ItemWebSnapshot *item = m_current.item;
+    if (item != NULL) {
+        QSize size = layoutPage( page(), m_current.width );
+        findText( page(), m_current.highlight );
+
+        // Pixmap width must match requested width even if page is empty.
+        size = size.expandedTo( QSize(1, 1) );
+        QPixmap pixmap(size);
+        pixmap.fill(Qt::transparent);
+        {
+            QPainter painter(&pixmap);
+            page()->mainFrame()->render(&painter);
+        }
+
+        m_cache.insert( m_current.key, new QPixmap(pixmap),
+                        qMax(1, size.width() * size.height() * 4 / 1024) );
+        item->setSnapshot(pixmap);
+    }
+
+    m_current = Request();
+
+    QTimer::singleShot( 0, this, SLOT(renderNext()) );
+}
+
+void ItemWebRenderer::renderNext()
+{
+    while ( !m_loading && !m_requests.isEmpty() ) {
+        m_current = m_requests.takeFirst();
+        ItemWebSnapshot *item = m_current.item;
+        if (item == NULL)
+            continue;
+
+        const QPixmap *pixmap = m_cache.object(m_current.key);
+        if (pixmap != NULL) {
+            item->setSnapshot(*pixmap);
+            continue;
+        }
+
+        m_loading = true;
+        page()->mainFrame()->setHtml( item->html() );
+    }
+}
+
+QWebPage *ItemWebRenderer::page()
+{
+    if (m_page == NULL) {
+        m_page = new QWebPage(this);
+        initPage( m_page, QApplication::font() );
+
+        QPalette pal( m_page->palette() );
+        pal.setBrush(QPalette::Base, Qt::transparent);
+        m_page->setPalette(pal);
+
+        connect( m_page->mainFrame(), SIGNAL(loadFinished(bool)),
+                 this, SLOT(onLoadFinished()) );
+    }
+
+    return m_page;
+}
+
 ItemWidget *ItemWebLoader::create(const QModelIndex &index, QWidget *parent) const
 {
     QString html;
-    if ( getHtml(index, &html) )
-        return new ItemWeb(html, parent);
+    if ( !getHtml(index, &html) )
+        return NULL;
+
+    if ( m_renderer.isNull() )
+        m_renderer = new ItemWebRenderer( const_cast<ItemWebLoader *>(this) );
 
-    return NULL;
+    return new ItemWebSnapshot(html, m_renderer, parent);
 }
 
 QStringList ItemWebLoader::formatsToSave() const
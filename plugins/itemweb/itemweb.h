@@ -22,12 +22,26 @@
 
 #include "item/itemwidget.h"
 
+#include <QCache>
+#include <QFont>
+#include <QList>
+#include <QPalette>
+#include <QPixmap>
+#include <QPointer>
+#include <QWidget>
+
 #if QT_VERSION < 0x050000
 #   include <QtWebKit/QWebView>
 #else
 #   include <QtWebKitWidgets/QWebView>
 #endif
 
+class ItemWebRenderer;
+class QWebPage;
+
+/**
+ * Live web view for item.
+ */
 class ItemWeb : public QWebView, public ItemWidget
 {
     Q_OBJECT
@@ -58,6 +72,94 @@ private slots:
     void onItemChanged();
 };
 
+/**
+ * Shows HTML item rendered to pixmap by ItemWebRenderer.
+ *
+ * Live web view (ItemWeb) is created only while the item is selected so it's
+ * possible to select and copy text.
+ */
+class ItemWebSnapshot : public QWidget, public ItemWidget
+{
+    Q_OBJECT
+
+public:
+    ItemWebSnapshot(const QString &html, ItemWebRenderer *renderer, QWidget *parent);
+
+    const QString &html() const { return m_html; }
+
+    /** Set rendered pixmap. */
+    void setSnapshot(const QPixmap &pixmap);
+
+    /** Create or destroy live web view. */
+    void setLive(bool live);
+
+protected:
+    virtual void updateSize();
+
+    void highlight(const QRegExp &re, const QFont &highlightFont,
+                   const QPalette &highlightPalette);
+
+    bool event(QEvent *event);
+
+    bool eventFilter(QObject *object, QEvent *event);
+
+    void paintEvent(QPaintEvent *event);
+
+private:
+    void requestSnapshot();
+
+    QString m_html;
+    QPointer<ItemWebRenderer> m_renderer;
+    QPixmap m_pixmap;
+    ItemWeb *m_liveView;
+    QRegExp m_re;
+    QFont m_highlightFont;
+    QPalette m_highlightPalette;
+};
+
+/**
+ * Renders HTML items to pixmaps using single off-screen web page.
+ *
+ * Items are rendered one at a time in order of requests. Rendered pixmaps are
+ * cached (by HTML, width and highlighted text) so recreated items are shown
+ * immediately.
+ */
+class ItemWebRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ItemWebRenderer(QObject *parent = NULL);
+
+    /** Render @a item with given @a width and highlighted text (replaces older request). */
+    void render(ItemWebSnapshot *item, int width, const QString &highlight);
+
+    /** Make @a item the only one with live web view. */
+    void setLiveItem(ItemWebSnapshot *item);
+
+private slots:
+    void onLoadFinished();
+
+    void renderNext();
+
+private:
+    struct Request {
+        QPointer<ItemWebSnapshot> item;
+        QString key;
+        int width;
+        QString highlight;
+    };
+
+    QWebPage *page();
+
+    QWebPage *m_page;
+    QList<Request> m_requests;
+    Request m_current;
+    bool m_loading;
+    QCache<QString, QPixmap> m_cache;
+    QPointer<ItemWebSnapshot> m_liveItem;
+};
+
 class ItemWebLoader : public QObject, public ItemLoaderInterface
 {
     Q_OBJECT
@@ -67,6 +169,8 @@ class ItemWebLoader : public QObject, public ItemLoaderInterface
 public:
     virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const;
 
+    virtual QStringList formatsToLoad() const { return QStringList("text/html"); }
+
     virtual int priority() const { return 10; }
 
     virtual QString id() const { return "itemweb"; }
@@ -75,6 +179,9 @@ public:
     virtual QString description() const { return tr("Display web pages."); }
 
     virtual QStringList formatsToSave() const;
+
+private:
+    mutable QPointer<ItemWebRenderer> m_renderer;
 };
 
 #endif // ITEMWEB_H
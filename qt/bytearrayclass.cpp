@@ -145,7 +145,7 @@ void ByteArrayClass::setProperty(QScriptValue &object,
                                  const QScriptString &name,
                                  uint id, const QScriptValue &value)
 {
-    QByteArray *ba = qscriptvalue_cast<QByteArray*>(object.data());
+    QByteArray *ba = byteArray(object);
     if (!ba)
         return;
 
@@ -212,6 +212,40 @@ QScriptValue ByteArrayClass::newInstance(const QByteArray &ba)
 }
 //! [1]
 
+// View references raw data of other array which is kept alive in data of
+// the view's data (this is never modified since scripts cannot access it).
+QScriptValue ByteArrayClass::newView(const QScriptValue &object, int pos, int len)
+{
+    QByteArray *ba = qscriptvalue_cast<QByteArray*>(object.data());
+    if (!ba)
+        return QScriptValue();
+
+    const int size = ba->size();
+    pos = qBound(0, pos, size);
+    if (len < 0 || len > size - pos)
+        len = size - pos;
+
+    QScriptValue owner = object.data().data();
+    if (!owner.isValid())
+        owner = engine()->newVariant(QVariant::fromValue(*ba));
+
+    QScriptValue data = engine()->newVariant(
+                QVariant::fromValue(QByteArray::fromRawData(ba->constData() + pos, len)) );
+    data.setData(owner);
+    return engine()->newObject(this, data);
+}
+
+QByteArray *ByteArrayClass::byteArray(const QScriptValue &object)
+{
+    QScriptValue data = object.data();
+    QByteArray *ba = qscriptvalue_cast<QByteArray*>(data);
+    if (ba && data.data().isValid()) {
+        *ba = QByteArray(ba->constData(), ba->size());
+        data.setData(QScriptValue());
+    }
+    return ba;
+}
+
 //! [2]
 QScriptValue ByteArrayClass::construct(QScriptContext *ctx, QScriptEngine *)
 {
@@ -247,6 +281,10 @@ QScriptValue ByteArrayClass::toScriptValueFromString(QScriptEngine *eng, const Q
 void ByteArrayClass::fromScriptValue(const QScriptValue &obj, QByteArray &ba)
 {
     ba = qvariant_cast<QByteArray>(obj.data().toVariant());
+
+    // Don't share raw data of view.
+    if (obj.data().data().isValid())
+        ba = QByteArray(ba.constData(), ba.size());
 }
 
 void ByteArrayClass::fromScriptValueToString(const QScriptValue &obj, QString &str)
@@ -61,6 +61,21 @@ public:
     QScriptValue newInstance(int size = 0);
     QScriptValue newInstance(const QByteArray &ba);
 
+    /**
+     * Return ByteArray with @a len bytes (or rest) from position @a pos of ByteArray @a object.
+     *
+     * Data are not copied until either object is modified.
+     */
+    QScriptValue newView(const QScriptValue &object, int pos, int len = -1);
+
+    /**
+     * Return data of ByteArray @a object or NULL.
+     *
+     * Data of view is copied first so it can be safely used after the object
+     * it references is destroyed.
+     */
+    static QByteArray *byteArray(const QScriptValue &object);
+
     QueryFlags queryProperty(const QScriptValue &object,
                              const QScriptString &name,
                              QueryFlags flags, uint *id);
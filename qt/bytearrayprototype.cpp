@@ -39,6 +39,7 @@
 ****************************************************************************/
 
 #include "bytearrayprototype.h"
+#include "bytearrayclass.h"
 #include <QtScript/QScriptEngine>
 
 Q_DECLARE_METATYPE(QByteArray*)
@@ -59,9 +60,20 @@ QByteArray *ByteArrayPrototype::thisByteArray() const
 }
 //! [0]
 
+QByteArray *ByteArrayPrototype::thisMutableByteArray() const
+{
+    return ByteArrayClass::byteArray(thisObject());
+}
+
+QScriptValue ByteArrayPrototype::view(int pos, int len) const
+{
+    ByteArrayClass *cls = static_cast<ByteArrayClass*>(thisObject().scriptClass());
+    return cls->newView(thisObject(), pos, len);
+}
+
 void ByteArrayPrototype::chop(int n)
 {
-    thisByteArray()->chop(n);
+    thisMutableByteArray()->chop(n);
 }
 
 bool ByteArrayPrototype::equals(const QByteArray &other)
@@ -69,27 +81,28 @@ bool ByteArrayPrototype::equals(const QByteArray &other)
     return *thisByteArray() == other;
 }
 
-QByteArray ByteArrayPrototype::left(int len) const
+QScriptValue ByteArrayPrototype::left(int len) const
 {
-    return thisByteArray()->left(len);
+    return view(0, qMax(0, len));
 }
 
 //! [1]
-QByteArray ByteArrayPrototype::mid(int pos, int len) const
+QScriptValue ByteArrayPrototype::mid(int pos, int len) const
 {
-    return thisByteArray()->mid(pos, len);
+    return view(pos, len);
 }
 
 QScriptValue ByteArrayPrototype::remove(int pos, int len)
 {
-    thisByteArray()->remove(pos, len);
+    thisMutableByteArray()->remove(pos, len);
     return thisObject();
 }
 //! [1]
 
-QByteArray ByteArrayPrototype::right(int len) const
+QScriptValue ByteArrayPrototype::right(int len) const
 {
-    return thisByteArray()->right(len);
+    const int size = thisByteArray()->size();
+    return view(size - qBound(0, len, size), -1);
 }
 
 QByteArray ByteArrayPrototype::simplified() const
@@ -119,7 +132,7 @@ QByteArray ByteArrayPrototype::trimmed() const
 
 void ByteArrayPrototype::truncate(int pos)
 {
-    thisByteArray()->truncate(pos);
+    thisMutableByteArray()->truncate(pos);
 }
 
 QString ByteArrayPrototype::toLatin1String() const
@@ -133,3 +146,69 @@ QScriptValue ByteArrayPrototype::valueOf() const
     return thisObject().data();
 }
 //! [2]
+
+namespace {
+
+/** Return data of ByteArray or string (so needle doesn't have to be converted in script). */
+QByteArray toByteArray(const QScriptValue &value)
+{
+    QByteArray *ba = qscriptvalue_cast<QByteArray*>(value.data());
+    return ba ? *ba : value.toString().toLocal8Bit();
+}
+
+} // namespace
+
+int ByteArrayPrototype::indexOf(const QScriptValue &needle, int from) const
+{
+    return thisByteArray()->indexOf(toByteArray(needle), from);
+}
+
+int ByteArrayPrototype::lastIndexOf(const QScriptValue &needle, int from) const
+{
+    return thisByteArray()->lastIndexOf(toByteArray(needle), from);
+}
+
+bool ByteArrayPrototype::contains(const QScriptValue &needle) const
+{
+    return thisByteArray()->contains(toByteArray(needle));
+}
+
+int ByteArrayPrototype::count(const QScriptValue &needle) const
+{
+    return thisByteArray()->count(toByteArray(needle));
+}
+
+bool ByteArrayPrototype::startsWith(const QScriptValue &needle) const
+{
+    return thisByteArray()->startsWith(toByteArray(needle));
+}
+
+bool ByteArrayPrototype::endsWith(const QScriptValue &needle) const
+{
+    return thisByteArray()->endsWith(toByteArray(needle));
+}
+
+QScriptValue ByteArrayPrototype::split(const QScriptValue &separator) const
+{
+    const QByteArray *ba = thisByteArray();
+    const QByteArray sep = toByteArray(separator);
+
+    QScriptValue result = engine()->newArray();
+    if (sep.isEmpty()) {
+        result.setProperty( 0, view(0, -1) );
+        return result;
+    }
+
+    quint32 i = 0;
+    int pos = 0;
+    forever {
+        const int end = ba->indexOf(sep, pos);
+        if (end == -1)
+            break;
+        result.setProperty( i++, view(pos, end - pos) );
+        pos = end + sep.size();
+    }
+    result.setProperty( i, view(pos, -1) );
+
+    return result;
+}
@@ -57,10 +57,10 @@ public:
 public slots:
     void chop(int n);
     bool equals(const QByteArray &other);
-    QByteArray left(int len) const;
-    QByteArray mid(int pos, int len = -1) const;
+    QScriptValue left(int len) const;
+    QScriptValue mid(int pos, int len = -1) const;
     QScriptValue remove(int pos, int len);
-    QByteArray right(int len) const;
+    QScriptValue right(int len) const;
     QByteArray simplified() const;
     QByteArray toBase64() const;
     QByteArray toLower() const;
@@ -70,8 +70,20 @@ public slots:
     QString toLatin1String() const;
     QScriptValue valueOf() const;
 
+    int indexOf(const QScriptValue &needle, int from = 0) const;
+    int lastIndexOf(const QScriptValue &needle, int from = -1) const;
+    bool contains(const QScriptValue &needle) const;
+    int count(const QScriptValue &needle) const;
+    bool startsWith(const QScriptValue &needle) const;
+    bool endsWith(const QScriptValue &needle) const;
+    QScriptValue split(const QScriptValue &separator) const;
+
 private:
     QByteArray *thisByteArray() const;
+    /** Return this array for modification (view is detached first). */
+    QByteArray *thisMutableByteArray() const;
+    /** Return slice of this array sharing its data. */
+    QScriptValue view(int pos, int len) const;
 };
 //! [0]
 
@@ -21,20 +21,54 @@
 
 #include "common/arguments.h"
 #include "common/client_server.h"
+#include "common/messagereader.h"
 #include "platform/platformnativeinterface.h"
 
 #include <QCoreApplication>
 #include <QFile>
 
+void StdinReader::run()
+{
+    QFile in;
+    in.open(stdin, QIODevice::ReadOnly);
+
+    forever {
+        const QByteArray line = in.readLine();
+        if ( line.isEmpty() )
+            break;
+        emit lineRead(line);
+    }
+}
+
 ClipboardClient::ClipboardClient(int &argc, char **argv, int skipArgc, const QString &sessionName)
     : QObject()
     , App(new QCoreApplication(argc, argv), sessionName)
     , m_client()
     , m_args(argc, argv, skipArgc + 1)
+    , m_receivingMessage(false)
+    , m_exitCode(0)
+    , m_windowId()
+    , m_session(false)
+    , m_pendingRequests(0)
+    , m_inputFinished(false)
 {
+    m_session = m_args.length() == Arguments::Rest + 1
+            && QString::fromUtf8(m_args.at(Arguments::Rest)) == sessionArgument;
+
     // client socket
-    connect( &m_client, SIGNAL(readyRead()),
-             this, SLOT(readyRead()) );
+    MessageReader *reader = new MessageReader(&m_client);
+    if (m_session) {
+        connect( reader, SIGNAL(messageReceived(QByteArray)),
+                 this, SLOT(onSessionMessage(QByteArray)) );
+    } else {
+        // Output is written as it arrives so huge messages are never kept in memory.
+        m_client.setReadBufferSize(2 * messageChunkBytes);
+        reader->setStreaming(true);
+        connect( reader, SIGNAL(chunkReceived(QByteArray,bool)),
+                 this, SLOT(onChunkReceived(QByteArray,bool)) );
+    }
+    connect( reader, SIGNAL(readError()),
+             this, SLOT(onReadError()) );
     connect( &m_client, SIGNAL(readChannelFinished()),
              this, SLOT(readFinnished()) );
     connect( &m_client, SIGNAL(error(QLocalSocket::LocalSocketError)),
@@ -58,46 +92,153 @@ void ClipboardClient::sendMessage()
     }
 
     COPYQ_LOG("Message send to server.");
+
+    if (m_session) {
+        // Thread can be blocked reading input at exit so it's never deleted.
+        StdinReader *inputReader = new StdinReader;
+        connect( inputReader, SIGNAL(lineRead(QByteArray)),
+                 this, SLOT(onInputLine(QByteArray)) );
+        connect( inputReader, SIGNAL(finished()),
+                 this, SLOT(onInputFinished()) );
+        inputReader->start();
+    }
 }
 
-void ClipboardClient::readyRead()
+void ClipboardClient::onChunkReceived(const QByteArray &chunk, bool lastChunk)
 {
-    COPYQ_LOG("Receiving message from server.");
+    int i = 0;
+    if (!m_receivingMessage) {
+        COPYQ_LOG("Receiving message from server.");
+        m_receivingMessage = true;
+        QDataStream in(chunk);
+        in >> m_exitCode;
+        i = sizeof(m_exitCode);
+    }
 
-    int exitCode, i, len;
-    QByteArray msg;
-    while ( m_client.bytesAvailable() ) {
-        if( !readMessage(&m_client, &msg) )
-            exit(1);
-
-        QDataStream in(&msg, QIODevice::ReadOnly);
-        in >> exitCode;
-        i = sizeof(exitCode);
-
-        len = msg.length();
-        if (len > i) {
-            if (exitCode == CommandActivateWindow) {
-                COPYQ_LOG("Activating window.");
-                WId wid = (WId)(QByteArray(msg.constData()+i).toLongLong());
-                createPlatformNativeInterface()->raiseWindow(wid);
-            } else {
-                QFile f;
-                f.open((exitCode == CommandSuccess) ? stdout : stderr, QIODevice::WriteOnly);
-                f.write( msg.constData() + i, len - i );
-            }
+    const int len = chunk.length();
+    if (len > i) {
+        if (m_exitCode == CommandActivateWindow) {
+            m_windowId.append( chunk.constData() + i, len - i );
+        } else {
+            QFile f;
+            f.open((m_exitCode == CommandSuccess) ? stdout : stderr, QIODevice::WriteOnly);
+            f.write( chunk.constData() + i, len - i );
         }
+    }
 
-        COPYQ_LOG( QString("Message received with exit code %1.").arg(exitCode) );
+    if (!lastChunk)
+        return;
 
-        if (exitCode == CommandFinished || exitCode == CommandBadSyntax || exitCode == CommandError) {
-            exit(exitCode);
-            break;
-        }
-        if (exitCode == CommandExit) {
-            exit(0);
-            break;
-        }
+    m_receivingMessage = false;
+
+    if (m_exitCode == CommandReadInput) {
+        sendInput();
+        return;
+    }
+
+    if ( m_exitCode == CommandActivateWindow && !m_windowId.isEmpty() ) {
+        COPYQ_LOG("Activating window.");
+        WId wid = (WId)(m_windowId.toLongLong());
+        createPlatformNativeInterface()->raiseWindow(wid);
+        m_windowId.clear();
+    }
+
+    COPYQ_LOG( QString("Message received with exit code %1.").arg(m_exitCode) );
+
+    if (m_exitCode == CommandFinished || m_exitCode == CommandBadSyntax || m_exitCode == CommandError)
+        exit(m_exitCode);
+    else if (m_exitCode == CommandExit)
+        exit(0);
+}
+
+void ClipboardClient::onSessionMessage(const QByteArray &msg)
+{
+    qint32 requestId;
+    int exitCode;
+    QDataStream in(msg);
+    in >> requestId >> exitCode;
+    const int i = sizeof(requestId) + sizeof(exitCode);
+    const QByteArray data = msg.mid(i);
+
+    COPYQ_LOG( QString("Message received for request %1 with exit code %2.")
+               .arg(requestId).arg(exitCode) );
+
+    if (exitCode == CommandActivateWindow) {
+        if ( !data.isEmpty() )
+            createPlatformNativeInterface()->raiseWindow( (WId)(data.toLongLong()) );
+        return;
+    }
+
+    QFile f;
+    f.open(stdout, QIODevice::WriteOnly);
+    f.write( QString("%1 %2 %3\n").arg(requestId).arg(exitCode).arg(data.size()).toLatin1() );
+    f.write(data);
+    f.write("\n");
+    f.flush();
+
+    if (exitCode == CommandFinished) {
+        --m_pendingRequests;
+        exitIfSessionFinished();
+    } else if (exitCode == CommandExit) {
+        exit(0);
+    }
+}
+
+void ClipboardClient::onInputLine(const QByteArray &line)
+{
+    QByteArray text = line;
+    while ( text.endsWith('\n') || text.endsWith('\r') )
+        text.chop(1);
+    if ( text.isEmpty() )
+        return;
+
+    QList<QByteArray> fields = text.split('\t');
+    bool ok;
+    const qint32 requestId = fields.takeFirst().toInt(&ok);
+    if (!ok || requestId < 0) {
+        log( tr("Invalid request ID in line: %1").arg(QString::fromUtf8(text)), LogError );
+        return;
     }
+
+    Arguments args;
+    foreach (const QByteArray &field, fields)
+        args.appendEscaped(field);
+
+    QByteArray msg;
+    QDataStream out(&msg, QIODevice::WriteOnly);
+    out << requestId << args;
+    writeMessage(&m_client, msg);
+
+    ++m_pendingRequests;
+}
+
+void ClipboardClient::onInputFinished()
+{
+    m_inputFinished = true;
+    exitIfSessionFinished();
+}
+
+void ClipboardClient::exitIfSessionFinished()
+{
+    if (m_inputFinished && m_pendingRequests == 0)
+        exit(0);
+}
+
+void ClipboardClient::sendInput()
+{
+    // Unbuffered so no input is lost when the file is closed.
+    QFile in;
+    in.open(stdin, QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    // Server requests next chunk only after processing previous one.
+    const QByteArray bytes = in.read(messageChunkBytes);
+    COPYQ_LOG( QString("Sending %1 bytes of input.").arg(bytes.size()) );
+    writeMessage(&m_client, bytes);
+}
+
+void ClipboardClient::onReadError()
+{
+    exit(1);
 }
 
 void ClipboardClient::readFinnished()
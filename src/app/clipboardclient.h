@@ -24,6 +24,21 @@
 #include "common/arguments.h"
 
 #include <QLocalSocket>
+#include <QThread>
+
+/**
+ * Reads lines from standard input in separate thread.
+ */
+class StdinReader : public QThread
+{
+    Q_OBJECT
+
+signals:
+    void lineRead(const QByteArray &line);
+
+protected:
+    void run();
+};
 
 /**
  * Application client.
@@ -32,6 +47,14 @@
  * Exit code is same as exit code send by ClipboardServer::sendMessage().
  * Also the received message is printed on standard output (if exit code is
  * zero) or standard error output.
+ *
+ * In session mode (with sessionArgument) client keeps the connection open and
+ * sends commands read from standard input. Each input line contains request ID,
+ * command and arguments separated by tabs (escape sequences \n, \t and \\
+ * can be used in arguments). Commands can run in parallel and for each message
+ * from server a line with request ID, exit code and size of data is printed
+ * followed by the data and a newline. Exit code 0 means that the command
+ * finished. Long output of a command is split into more messages.
  */
 class ClipboardClient : public QObject, public App
 {
@@ -45,9 +68,32 @@ private:
     QLocalSocket m_client;
     Arguments m_args;
 
+    /** True if some chunks of current message were received. */
+    bool m_receivingMessage;
+    /** Exit code of current message. */
+    int m_exitCode;
+    /** Window to activate (from CommandActivateWindow message). */
+    QByteArray m_windowId;
+
+    /** True if client reads commands from standard input. */
+    bool m_session;
+    /** Number of commands sent in session which haven't finished yet. */
+    int m_pendingRequests;
+    bool m_inputFinished;
+
+    /** Exit if all commands in session finished and there is no more input. */
+    void exitIfSessionFinished();
+
+    /** Send next chunk of standard input to server (on CommandReadInput). */
+    void sendInput();
+
 private slots:
     void sendMessage();
-    void readyRead();
+    void onChunkReceived(const QByteArray &chunk, bool lastChunk);
+    void onSessionMessage(const QByteArray &msg);
+    void onInputLine(const QByteArray &line);
+    void onInputFinished();
+    void onReadError();
     void readFinnished();
     void error(QLocalSocket::LocalSocketError);
 };
@@ -20,7 +20,7 @@
 #include "clipboardmonitor.h"
 
 #include "common/client_server.h"
-#include "item/clipboarditem.h"
+#include "common/messagereader.h"
 #include "platform/platformnativeinterface.h"
 
 #include <QApplication>
@@ -28,6 +28,7 @@
 #include <QTimer>
 
 #ifdef COPYQ_WS_X11
+#  include "platform/x11/x11inputwatcher.h"
 #  include "platform/x11/x11platform.h"
 #endif
 
@@ -42,13 +43,78 @@ void setClipboardData(QMimeData *data, QClipboard::Mode mode)
     QApplication::clipboard()->setMimeData(data, mode);
 }
 
+// Interval for reading clipboard after change from a source which doesn't update it rapidly.
+const int minUpdateIntervalMs = 50;
+// Maximum interval for coalescing rapid changes.
+const int maxUpdateIntervalMs = 500;
+// Changes with longer interval are not coalesced.
+const int rapidChangeIntervalMs = 250;
+// Longer interval between changes starts new series of changes.
+const int changeSeriesIntervalMs = 1000;
+// Interval after clipboard is changed by server.
+const int serverUpdateIntervalMs = 300;
+// Maximum number of sources to keep statistics for.
+const int maxSourceCount = 100;
+
 } // namespace
 
+ClipboardSource::ClipboardSource()
+    : m_lastChange()
+    , m_averageInterval(-1)
+    , m_capturedCount(0)
+    , m_droppedCount(0)
+    , m_totalLatency(0)
+    , m_maxLatency(0)
+{
+}
+
+void ClipboardSource::changed()
+{
+    if ( m_lastChange.isValid() ) {
+        const qint64 interval = m_lastChange.restart();
+        if (interval > changeSeriesIntervalMs)
+            m_averageInterval = -1;
+        else if (m_averageInterval < 0)
+            m_averageInterval = interval;
+        else
+            m_averageInterval = (3 * m_averageInterval + interval) / 4;
+    } else {
+        m_lastChange.start();
+    }
+}
+
+int ClipboardSource::updateInterval() const
+{
+    if (m_averageInterval < 0 || m_averageInterval > rapidChangeIntervalMs)
+        return minUpdateIntervalMs;
+
+    // Wait a bit longer than usual interval between changes.
+    return qBound<int>( minUpdateIntervalMs, 2 * m_averageInterval, maxUpdateIntervalMs );
+}
+
+void ClipboardSource::captured(qint64 latency)
+{
+    ++m_capturedCount;
+    m_totalLatency += latency;
+    m_maxLatency = qMax(m_maxLatency, latency);
+}
+
+QString ClipboardSource::statistics() const
+{
+    return QString("%1 captured, %2 dropped, latency %3 ms average, %4 ms maximum")
+            .arg(m_capturedCount)
+            .arg(m_droppedCount)
+            .arg(m_capturedCount > 0 ? m_totalLatency / m_capturedCount : 0)
+            .arg(m_maxLatency);
+}
+
 #ifdef COPYQ_WS_X11
 class PrivateX11 {
 public:
     PrivateX11()
         : m_dsp()
+        , m_inputWatcher()
+        , m_waitingForRelease(false)
         , m_timer()
         , m_syncTimer()
         , m_syncData(NULL)
@@ -57,7 +123,8 @@ public:
         m_timer.setSingleShot(true);
         m_timer.setInterval(100);
         m_syncTimer.setSingleShot(true);
-        m_syncTimer.setInterval(100);
+        // Polling is not needed if input events are watched.
+        m_syncTimer.setInterval(m_inputWatcher.isValid() ? 0 : 100);
     }
 
     ~PrivateX11()
@@ -67,6 +134,11 @@ public:
 
     bool waitForKeyRelease()
     {
+        if ( m_inputWatcher.isValid() ) {
+            m_waitingForRelease = m_dsp.isSelecting();
+            return m_waitingForRelease;
+        }
+
         if (m_timer.isActive())
             return true;
 
@@ -78,6 +150,19 @@ public:
         return false;
     }
 
+    /** Return true if waitForKeyRelease() was waiting (key or button was released). */
+    bool finishWaitingForKeyRelease()
+    {
+        const bool wasWaiting = m_waitingForRelease;
+        m_waitingForRelease = false;
+        return wasWaiting;
+    }
+
+    const X11InputWatcher &inputWatcher() const
+    {
+        return m_inputWatcher;
+    }
+
     const QTimer &timer() const
     {
         return m_timer;
@@ -110,7 +195,8 @@ public:
             return;
 
         if (m_syncTo == QClipboard::Selection && waitForKeyRelease()) {
-            m_syncTimer.start();
+            if ( !m_inputWatcher.isValid() )
+                m_syncTimer.start();
             return;
         }
 
@@ -121,11 +207,13 @@ public:
 
     bool isSynchronizing()
     {
-        return !m_syncTimer.isActive() && m_syncData != NULL;
+        return !m_syncTimer.isActive() && !m_waitingForRelease && m_syncData != NULL;
     }
 
 private:
     X11Platform m_dsp;
+    X11InputWatcher m_inputWatcher;
+    bool m_waitingForRelease;
     QTimer m_timer;
     QTimer m_syncTimer;
     QMimeData *m_syncData;
@@ -144,15 +232,30 @@ ClipboardMonitor::ClipboardMonitor(int &argc, char **argv)
     , m_copysel(false)
 #endif
     , m_socket( new QLocalSocket(this) )
+    , m_codec()
+    , m_manifestId(0)
+    , m_manifestMode(QClipboard::Clipboard)
+    , m_manifestWindowTitle()
+    , m_manifestFingerprint(0)
+    , m_lastHashes()
+    , m_lastFingerprints()
+    , m_platform( createPlatformNativeInterface() )
     , m_updateTimer( new QTimer(this) )
     , m_needCheckClipboard(false)
+    , m_sources()
+    , m_lastSource()
+    , m_lastWindowTitle()
+    , m_pendingChange()
 #ifdef COPYQ_WS_X11
     , m_needCheckSelection(false)
     , m_x11(new PrivateX11)
 #endif
 {
-    connect( m_socket, SIGNAL(readyRead()),
-             this, SLOT(readyRead()), Qt::DirectConnection );
+    MessageReader *reader = new MessageReader(m_socket);
+    connect( reader, SIGNAL(messageReceived(QByteArray)),
+             this, SLOT(onMessageReceived(QByteArray)) );
+    connect( reader, SIGNAL(readError()),
+             this, SLOT(onReadError()) );
     connect( m_socket, SIGNAL(disconnected()),
              QApplication::instance(), SLOT(quit()) );
 
@@ -169,7 +272,7 @@ ClipboardMonitor::ClipboardMonitor(int &argc, char **argv)
     COPYQ_LOG("Connected to server.");
 
     m_updateTimer->setSingleShot(true);
-    m_updateTimer->setInterval(300);
+    m_updateTimer->setInterval(serverUpdateIntervalMs);
     connect( m_updateTimer, SIGNAL(timeout()),
              this, SLOT(updateTimeout()));
 
@@ -178,11 +281,22 @@ ClipboardMonitor::ClipboardMonitor(int &argc, char **argv)
              this, SLOT(updateSelection()) );
     connect( &m_x11->syncTimer(), SIGNAL(timeout()),
              this, SLOT(synchronize()) );
+    connect( &m_x11->inputWatcher(), SIGNAL(released()),
+             this, SLOT(inputReleased()) );
 #endif
 }
 
 ClipboardMonitor::~ClipboardMonitor()
 {
+#ifdef COPYQ_LOG_DEBUG
+    for ( QHash<QString, ClipboardSource>::const_iterator it = m_sources.constBegin();
+          it != m_sources.constEnd(); ++it )
+    {
+        if ( it->capturedCount() > 0 )
+            COPYQ_LOG( QString("Clipboard changes from \"%1\": %2").arg(it.key()).arg(it->statistics()) );
+    }
+#endif
+
 #ifdef COPYQ_WS_X11
     delete m_x11;
 #endif
@@ -207,6 +321,14 @@ void ClipboardMonitor::synchronize()
 {
     m_x11->synchronize();
 }
+
+void ClipboardMonitor::inputReleased()
+{
+    if ( m_x11->finishWaitingForKeyRelease() ) {
+        synchronize();
+        updateSelection();
+    }
+}
 #endif /* !COPYQ_WS_X11 */
 
 void ClipboardMonitor::checkClipboard(QClipboard::Mode mode)
@@ -217,19 +339,65 @@ void ClipboardMonitor::checkClipboard(QClipboard::Mode mode)
     m_x11->synchronizeNone();
 #endif
 
+    ClipboardSource &source = changeSource();
+    if ( !m_pendingChange.isValid() )
+        m_pendingChange.start();
+
     // Check clipboard after interval because someone is updating it very quickly.
     bool needToWait = m_updateTimer->isActive();
-    if (mode == QClipboard::Clipboard)
+    if (mode == QClipboard::Clipboard) {
+        if (needToWait && m_needCheckClipboard)
+            source.dropped();
         m_needCheckClipboard = needToWait;
 #ifdef COPYQ_WS_X11
-    else if (mode == QClipboard::Selection)
+    } else if (mode == QClipboard::Selection) {
+        if (needToWait && m_needCheckSelection)
+            source.dropped();
         m_needCheckSelection = needToWait;
 #endif
+    }
 
-    m_updateTimer->start();
+    m_updateTimer->start( source.updateInterval() );
     if (needToWait)
         return;
 
+    readClipboard(mode);
+}
+
+ClipboardSource &ClipboardMonitor::changeSource()
+{
+    const WId wid = m_platform->getCurrentWindow();
+    m_lastWindowTitle = m_platform->getWindowTitle(wid);
+    m_lastSource = m_platform->getWindowClass(wid);
+
+    // Forget least recently used source.
+    if ( m_sources.size() >= maxSourceCount && !m_sources.contains(m_lastSource) ) {
+        QHash<QString, ClipboardSource>::iterator oldest = m_sources.begin();
+        for ( QHash<QString, ClipboardSource>::iterator it = m_sources.begin();
+              it != m_sources.end(); ++it )
+        {
+            if ( it->lastChangeTime() < oldest->lastChangeTime() )
+                oldest = it;
+        }
+        m_sources.erase(oldest);
+    }
+
+    ClipboardSource &source = m_sources[m_lastSource];
+    source.changed();
+    return source;
+}
+
+void ClipboardMonitor::readClipboard(QClipboard::Mode mode)
+{
+    if ( m_pendingChange.isValid() ) {
+        const qint64 latency = m_pendingChange.elapsed();
+        m_pendingChange.invalidate();
+        ClipboardSource &source = m_sources[m_lastSource];
+        source.captured(latency);
+        COPYQ_LOG( QString("Clipboard changes from \"%1\": %2")
+                   .arg(m_lastSource).arg(source.statistics()) );
+    }
+
     COPYQ_LOG( QString("Checking for new %1 content.")
                .arg(mode == QClipboard::Clipboard ? "clipboard" : "selection") );
 #ifdef COPYQ_WS_X11
@@ -261,119 +429,190 @@ void ClipboardMonitor::checkClipboard(QClipboard::Mode mode)
         return;
     }
 
-    // clone only mime types defined by user
-    QMimeData *data2 = cloneData(*data, &m_formats);
-
-    // add window title of clipboard owner
-    PlatformPtr platform = createPlatformNativeInterface();
-    data2->setData( QString(mimeWindowTitle),
-                    platform->getWindowTitle(platform->getCurrentWindow()).toUtf8() );
-
 #ifdef COPYQ_WS_X11
     if (mode == QClipboard::Clipboard) {
-        if (m_copyclip)
-            m_x11->synchronize(data2, QClipboard::Selection);
-        clipboardChanged(mode, data2);
+        if (m_copyclip) {
+            // clone only mime types defined by user
+            QScopedPointer<QMimeData> syncData( cloneData(*data, &m_formats) );
+            m_x11->synchronize(syncData.data(), QClipboard::Selection);
+        }
+        clipboardChanged(mode, *data);
     } else {
-        if (m_copysel)
-            m_x11->synchronize(data2, QClipboard::Clipboard);
+        if (m_copysel) {
+            QScopedPointer<QMimeData> syncData( cloneData(*data, &m_formats) );
+            m_x11->synchronize(syncData.data(), QClipboard::Clipboard);
+        }
         if (m_checksel)
-            clipboardChanged(mode, data2);
-        else
-            delete data2;
+            clipboardChanged(mode, *data);
     }
 #else /* !COPYQ_WS_X11 */
-    clipboardChanged(mode, data2);
+    clipboardChanged(mode, *data);
 #endif
 }
 
-void ClipboardMonitor::clipboardChanged(QClipboard::Mode, QMimeData *data)
+void ClipboardMonitor::clipboardChanged(QClipboard::Mode mode, const QMimeData &data)
 {
-    ClipboardItem item;
+    // Checking available formats is cheap, only fingerprint is computed and
+    // data are retrieved if server requests them.
+    QStringList formats;
+    foreach (const QString &format, m_formats) {
+        if ( data.hasFormat(format) )
+            formats.append(format);
+    }
+
+    if ( formats.isEmpty() )
+        return;
+
+    // remember window title of clipboard owner
+    m_manifestWindowTitle = m_lastWindowTitle.toUtf8();
+    m_manifestMode = mode;
+    m_manifestFingerprint = fingerprint(data, formats);
+    ++m_manifestId;
+
+    QVariantMap manifest;
+    manifest["id"] = m_manifestId;
+    manifest["formats"] = formats;
+    manifest["fingerprint"] = m_manifestFingerprint;
+
+    QString messageFormat = mimeClipboardManifest;
+    if ( m_lastFingerprints.contains(mode) && m_lastFingerprints[mode] == m_manifestFingerprint ) {
+        // Same data were set again; server only needs to know that clipboard was touched.
+        COPYQ_LOG("Clipboard data didn't change.");
+        manifest["hash"] = m_lastHashes[mode];
+        messageFormat = mimeClipboardTouched;
+    }
 
-    item.setData(data);
+    QByteArray manifestData;
+    QDataStream manifestOut(&manifestData, QIODevice::WriteOnly);
+    manifestOut << manifest;
 
-    // send clipboard item
-    QByteArray msg;
-    QDataStream out(&msg, QIODevice::WriteOnly);
-    out << item;
-    writeMessage(m_socket, msg);
+    QMimeData msg;
+    msg.setData(messageFormat, manifestData);
+    writeMessage( m_socket, m_codec.serialize(msg) );
+}
+
+void ClipboardMonitor::sendClipboardData(const QVariantMap &request)
+{
+    // Newer manifest was sent after the request.
+    if ( request.value("id").toInt() != m_manifestId ) {
+        COPYQ_LOG("Ignoring request for old clipboard data.");
+        return;
+    }
+
+    const QMimeData *data = clipboardData(m_manifestMode);
+    if (!data) {
+        log( tr("Cannot access clipboard data!"), LogError );
+        return;
+    }
+
+    const QStringList formats = request.value("formats").toStringList();
+    QScopedPointer<QMimeData> data2( cloneData(*data, &formats) );
+    data2->setData(mimeWindowTitle, m_manifestWindowTitle);
+
+    // Hash covers all formats (same as hash of item created from the data in server).
+    m_lastHashes[m_manifestMode] = hash( *data2, data2->formats() );
+    m_lastFingerprints[m_manifestMode] = m_manifestFingerprint;
+
+    writeMessage( m_socket, m_codec.serialize(*data2) );
 }
 
 void ClipboardMonitor::updateTimeout()
 {
     if (m_needCheckClipboard) {
-        checkClipboard(QClipboard::Clipboard);
+        m_needCheckClipboard = false;
+        m_updateTimer->start();
+        readClipboard(QClipboard::Clipboard);
 #ifdef COPYQ_WS_X11
     } else if (m_needCheckSelection) {
-        checkClipboard(QClipboard::Selection);
+        m_needCheckSelection = false;
+        m_updateTimer->start();
+        readClipboard(QClipboard::Selection);
 #endif
     } else if (m_newdata) {
         updateClipboard();
     }
 }
 
-void ClipboardMonitor::readyRead()
+void ClipboardMonitor::onMessageReceived(const QByteArray &message)
 {
-    m_socket->blockSignals(true);
+    QScopedPointer<QMimeData> data(new QMimeData);
+    QStringList sharedKeys;
+    const bool ok = MimeDataCodec::deserialize(message, data.data(), &sharedKeys);
 
-    while ( m_socket->bytesAvailable() > 0 ) {
-        QByteArray msg;
-        if( !readMessage(m_socket, &msg) ) {
-            log( tr("Cannot read message from server!"), LogError );
-            return;
-        }
+    // Server can release shared memory after the data were copied.
+    if ( !sharedKeys.isEmpty() )
+        writeMessage( m_socket, MimeDataCodec::releaseMessage(sharedKeys) );
 
-        ClipboardItem item;
-        QDataStream in(&msg, QIODevice::ReadOnly);
-        in >> item;
+    if (!ok) {
+        log( tr("Cannot read clipboard data from server!"), LogError );
+        return;
+    }
 
-        /* Does server send settings for monitor? */
-        QByteArray settings_data = item.data()->data("application/x-copyq-settings");
-        if ( !settings_data.isEmpty() ) {
+    if ( m_codec.release(*data) )
+        return;
 
-            QDataStream settings_in(settings_data);
-            QVariantMap settings;
-            settings_in >> settings;
+    /* Does server request clipboard data? */
+    const QByteArray requestData = data->data(mimeClipboardRequest);
+    if ( !requestData.isEmpty() ) {
+        QDataStream requestIn(requestData);
+        QVariantMap request;
+        requestIn >> request;
+        sendClipboardData(request);
+        return;
+    }
+
+    /* Does server send settings for monitor? */
+    QByteArray settings_data = data->data("application/x-copyq-settings");
+    if ( !settings_data.isEmpty() ) {
+
+        QDataStream settings_in(settings_data);
+        QVariantMap settings;
+        settings_in >> settings;
 
 #ifdef COPYQ_LOG_DEBUG
-            {
-                COPYQ_LOG("Loading configuration:");
-                foreach (const QString &key, settings.keys()) {
-                    QVariant val = settings[key];
-                    const QString str = val.canConvert<QStringList>() ? val.toStringList().join(",")
-                                                                      : val.toString();
-                    COPYQ_LOG( QString("    %1=%2").arg(key).arg(str) );
-                }
+        {
+            COPYQ_LOG("Loading configuration:");
+            foreach (const QString &key, settings.keys()) {
+                QVariant val = settings[key];
+                const QString str = val.canConvert<QStringList>() ? val.toStringList().join(",")
+                                                                  : val.toString();
+                COPYQ_LOG( QString("    %1=%2").arg(key).arg(str) );
             }
+        }
 #endif
 
-            if ( settings.contains("formats") )
-                m_formats = settings["formats"].toStringList();
+        if ( settings.contains("formats") )
+            m_formats = settings["formats"].toStringList();
 #ifdef COPYQ_WS_X11
-            if ( settings.contains("copy_clipboard") )
-                m_copyclip = settings["copy_clipboard"].toBool();
-            if ( settings.contains("copy_selection") )
-                m_copysel = settings["copy_selection"].toBool();
-            if ( settings.contains("check_selection") )
-                m_checksel = settings["check_selection"].toBool();
+        if ( settings.contains("copy_clipboard") )
+            m_copyclip = settings["copy_clipboard"].toBool();
+        if ( settings.contains("copy_selection") )
+            m_copysel = settings["copy_selection"].toBool();
+        if ( settings.contains("check_selection") )
+            m_checksel = settings["check_selection"].toBool();
 #endif
 
-            connect( QApplication::clipboard(), SIGNAL(changed(QClipboard::Mode)),
-                     this, SLOT(checkClipboard(QClipboard::Mode)) );
+        connect( QApplication::clipboard(), SIGNAL(changed(QClipboard::Mode)),
+                 this, SLOT(checkClipboard(QClipboard::Mode)) );
 
 #ifdef COPYQ_WS_X11
-            checkClipboard(QClipboard::Selection);
+        checkClipboard(QClipboard::Selection);
 #endif
-            checkClipboard(QClipboard::Clipboard);
+        checkClipboard(QClipboard::Clipboard);
 
-            COPYQ_LOG("Configured");
-        } else {
-            updateClipboard( cloneData(*item.data()) );
-        }
+        COPYQ_LOG("Configured");
+    } else {
+        // Same data from other application after this change must be sent to server.
+        m_lastHashes.clear();
+        m_lastFingerprints.clear();
+        updateClipboard( data.take() );
     }
+}
 
-    m_socket->blockSignals(false);
+void ClipboardMonitor::onReadError()
+{
+    log( tr("Cannot read message from server!"), LogError );
+    exit(1);
 }
 
 void ClipboardMonitor::updateClipboard(QMimeData *data)
@@ -394,6 +633,6 @@ void ClipboardMonitor::updateClipboard(QMimeData *data)
 
     m_newdata.reset();
 
-    m_updateTimer->start();
+    m_updateTimer->start(serverUpdateIntervalMs);
 }
 
@@ -23,11 +23,17 @@
 #include "app.h"
 
 #include "common/client_server.h"
+#include "common/mimedatacodec.h"
+#include "platform/platformnativeinterface.h"
 
 #include <QClipboard>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QLocalSocket>
+#include <QMap>
 #include <QScopedPointer>
 #include <QStringList>
+#include <QVariantMap>
 
 class QMimeData;
 class QTimer;
@@ -35,6 +41,51 @@ class QTimer;
 class PrivateX11;
 #endif
 
+/**
+ * Clipboard changes from single source (window class of clipboard owner).
+ *
+ * Learns how often the source updates clipboard so that single changes can be
+ * read immediately and rapid changes are coalesced.
+ */
+class ClipboardSource
+{
+public:
+    ClipboardSource();
+
+    /** Update average interval between changes. */
+    void changed();
+
+    /** Return interval (in milliseconds) to wait for next change before reading clipboard. */
+    int updateInterval() const;
+
+    /** Clipboard was read @a latency milliseconds after first change. */
+    void captured(qint64 latency);
+
+    /** Change was overwritten by next one before clipboard was read. */
+    void dropped() { ++m_droppedCount; }
+
+    /** Return statistics as text. */
+    QString statistics() const;
+
+    int capturedCount() const { return m_capturedCount; }
+
+    /** Return time of last change (to find least recently used source). */
+    qint64 lastChangeTime() const
+    {
+        return m_lastChange.isValid() ? m_lastChange.msecsSinceReference() : 0;
+    }
+
+private:
+    QElapsedTimer m_lastChange;
+    /** Average interval between rapid changes in milliseconds (-1 if not known). */
+    qint64 m_averageInterval;
+
+    int m_capturedCount;
+    int m_droppedCount;
+    qint64 m_totalLatency;
+    qint64 m_maxLatency;
+};
+
 /**
  * Application monitor server.
  *
@@ -45,6 +96,15 @@ class PrivateX11;
  *
  * After monitor is executed it needs to be configured by sending special data
  * packet containing configuration.
+ *
+ * Clipboard is read immediately after single change. Rapid changes from the
+ * same source are coalesced and only the last one is read (see ClipboardSource).
+ *
+ * On clipboard change only manifest (available formats and their fingerprint)
+ * is sent to server and server requests the data, so data of outdated or
+ * duplicate clipboard changes are never retrieved. If the fingerprint is same
+ * as for the last data sent for the same clipboard mode, server is only
+ * notified that clipboard was touched (with hash of the last data).
  */
 class ClipboardMonitor : public QObject, public App
 {
@@ -73,11 +133,32 @@ private:
     bool m_copysel;
 #endif
     QLocalSocket *m_socket;
+    MimeDataCodec m_codec;
+
+    // last manifest sent to server
+    int m_manifestId;
+    QClipboard::Mode m_manifestMode;
+    QByteArray m_manifestWindowTitle;
+    uint m_manifestFingerprint;
+    /** Hash of last data sent to server for each clipboard mode. */
+    QMap<QClipboard::Mode, uint> m_lastHashes;
+    /** Fingerprint of last data sent to server for each clipboard mode (see fingerprint()). */
+    QMap<QClipboard::Mode, uint> m_lastFingerprints;
+
+    PlatformPtr m_platform;
 
     // don't allow rapid access to clipboard
     QTimer *m_updateTimer;
     bool m_needCheckClipboard;
 
+    // sources of clipboard changes (window classes) and their statistics
+    QHash<QString, ClipboardSource> m_sources;
+    QString m_lastSource;
+    /** Window title of clipboard owner for last change. */
+    QString m_lastWindowTitle;
+    /** Time since first change not yet read (invalid if there is no such change). */
+    QElapsedTimer m_pendingChange;
+
 #ifdef COPYQ_WS_X11
     bool m_needCheckSelection;
 
@@ -85,8 +166,21 @@ private:
     PrivateX11* m_x11;
 #endif
 
-    /** Send new clipboard or primary selection data to server. */
-    void clipboardChanged(QClipboard::Mode mode, QMimeData *data);
+    /** Return source of current clipboard change and update its statistics. */
+    ClipboardSource &changeSource();
+
+    /** Read clipboard or primary selection and send manifest to server if needed. */
+    void readClipboard(QClipboard::Mode mode);
+
+    /**
+     * Send manifest of new clipboard or primary selection data to server.
+     *
+     * If data fingerprint didn't change, only notify server that clipboard was touched.
+     */
+    void clipboardChanged(QClipboard::Mode mode, const QMimeData &data);
+
+    /** Send clipboard data requested by server after receiving manifest. */
+    void sendClipboardData(const QVariantMap &request);
 
 public slots:
     /**
@@ -112,13 +206,22 @@ private slots:
      * Synchronize clipboard and X11 primary selection.
      */
     void synchronize();
+
+    /**
+     * Synchronize and check primary selection after user finished selecting
+     * (mouse button or shift key released).
+     */
+    void inputReleased();
 #endif
 
     /** Update clipboard data in reasonably long intervals. */
     void updateTimeout();
 
-    /** Data can be received from monitor. */
-    void readyRead();
+    /** Message received from server. */
+    void onMessageReceived(const QByteArray &message);
+
+    /** Cannot read message from server. */
+    void onReadError();
 };
 
 #endif // CLIPBOARDMONITOR_H
@@ -21,6 +21,8 @@
 
 #include "app/remoteprocess.h"
 #include "common/arguments.h"
+#include "common/messagereader.h"
+#include "common/messagewriter.h"
 #include "gui/clipboardbrowser.h"
 #include "gui/configurationmanager.h"
 #include "gui/mainwindow.h"
@@ -34,6 +36,8 @@
 #include <QLocalServer>
 #include <QLocalSocket>
 #include <QMenu>
+#include <QMimeData>
+#include <QStringList>
 #include <QThread>
 
 #ifdef NO_GLOBAL_SHORTCUTS
@@ -48,8 +52,11 @@ ClipboardServer::ClipboardServer(int &argc, char **argv, const QString &sessionN
     , m_server(NULL)
     , m_wnd(NULL)
     , m_monitor(NULL)
+    , m_monitorCodec()
     , m_checkclip(false)
     , m_lastHash(0)
+    , m_lastFingerprint()
+    , m_requestedFingerprint()
     , m_shortcutActions()
     , m_clientThreads()
 {
@@ -173,6 +180,9 @@ void ClipboardServer::startMonitoring()
     COPYQ_LOG("Starting monitor.");
 
     if ( m_monitor == NULL ) {
+        // Previous monitor process won't acknowledge data anymore.
+        m_monitorCodec.releaseAll();
+
         m_monitor = new RemoteProcess(this);
         connect( &m_monitor->process(), SIGNAL(stateChanged(QProcess::ProcessState)),
                  this, SLOT(monitorStateChanged(QProcess::ProcessState)) );
@@ -222,13 +232,9 @@ void ClipboardServer::loadMonitorSettings()
     QDataStream settings_out(&settings_data, QIODevice::WriteOnly);
     settings_out << settings;
 
-    ClipboardItem item;
-    item.setData("application/x-copyq-settings", settings_data);
-
-    QByteArray msg;
-    QDataStream out(&msg, QIODevice::WriteOnly);
-    out << item;
-    m_monitor->writeMessage(msg);
+    QMimeData data;
+    data.setData("application/x-copyq-settings", settings_data);
+    m_monitor->writeMessage( m_monitorCodec.serialize(data) );
 }
 
 bool ClipboardServer::isMonitoring()
@@ -246,25 +252,98 @@ void ClipboardServer::newConnection()
     COPYQ_LOG( QString("%1: Receiving message from client.").arg(id) );
 #endif
 
+    // Reader is deleted after first message is received.
+    MessageReader *reader = new MessageReader(client);
+    connect( reader, SIGNAL(messageReceived(QByteArray)),
+             this, SLOT(newClientMessage(QByteArray)) );
+    connect( reader, SIGNAL(readError()),
+             this, SLOT(clientReadError()) );
+    connect( client, SIGNAL(disconnected()),
+             reader, SIGNAL(readError()) );
+
+    // Message may have arrived already.
+    reader->readAvailable();
+}
+
+void ClipboardServer::newClientMessage(const QByteArray &message)
+{
+    MessageReader *reader = qobject_cast<MessageReader*>(sender());
+    Q_ASSERT(reader != NULL);
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(reader->device());
+    Q_ASSERT(client != NULL);
+
+    reader->disconnect(this);
+
     Arguments args;
-    QByteArray msg;
+    QDataStream in(message);
+    in >> args;
 
-    if ( readMessage(client, &msg) ) {
-        QDataStream in(msg);
-        in >> args;
+#ifdef COPYQ_LOG_DEBUG
+    quintptr id = client->socketDescriptor();
+    COPYQ_LOG( QString("%1: Message received from client.").arg(id) );
+#endif
 
-        COPYQ_LOG( QString("%1: Message received from client.").arg(id) );
+    if ( args.length() == Arguments::Rest + 1
+         && QString::fromUtf8(args.at(Arguments::Rest)) == sessionArgument )
+    {
+        COPYQ_LOG( QString("%1: Starting client session.").arg(id) );
+        m_sessionRequests[client] = 0;
+        connect( reader, SIGNAL(messageReceived(QByteArray)),
+                 this, SLOT(newSessionMessage(QByteArray)) );
+        connect( client, SIGNAL(disconnected()),
+                 this, SLOT(sessionDisconnected()) );
+        return;
+    }
 
-        // try to handle command
-        doCommand(args, client);
-    } else {
-        const QString error = client->errorString();
-        log( tr("Cannot read message from client! (%1)").arg(error), LogError );
+    // try to handle command (reader is kept to pass client's input to command)
+    doCommand(args, client);
+}
+
+void ClipboardServer::newSessionMessage(const QByteArray &message)
+{
+    MessageReader *reader = qobject_cast<MessageReader*>(sender());
+    Q_ASSERT(reader != NULL);
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(reader->device());
+    Q_ASSERT(client != NULL);
+
+    qint32 requestId;
+    Arguments args;
+    QDataStream in(message);
+    in >> requestId >> args;
+
+    COPYQ_LOG( QString("Session request %1 received from client.").arg(requestId) );
+
+    doCommand(args, client, requestId);
+}
+
+void ClipboardServer::sessionDisconnected()
+{
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(sender());
+    Q_ASSERT(client != NULL);
+
+    // Wait for running commands to finish.
+    if ( m_sessionRequests.value(client, 0) == 0 ) {
+        m_sessionRequests.remove(client);
         client->deleteLater();
     }
 }
 
-void ClipboardServer::sendMessage(QLocalSocket* client, const QByteArray &message, int exitCode)
+void ClipboardServer::clientReadError()
+{
+    MessageReader *reader = qobject_cast<MessageReader*>(sender());
+    Q_ASSERT(reader != NULL);
+    QIODevice *client = reader->device();
+
+    reader->disconnect(this);
+
+    if (client != NULL) {
+        log( tr("Cannot read message from client! (%1)").arg(client->errorString()), LogError );
+        client->deleteLater();
+    }
+}
+
+void ClipboardServer::sendMessage(QLocalSocket* client, const QByteArray &message, int exitCode,
+                                  int requestId)
 {
 #ifdef COPYQ_LOG_DEBUG
     quintptr id = client->socketDescriptor();
@@ -275,43 +354,143 @@ void ClipboardServer::sendMessage(QLocalSocket* client, const QByteArray &messag
                .arg(exitCode) );
 
     if ( client->state() == QLocalSocket::ConnectedState ) {
-        QByteArray msg;
-        QDataStream out(&msg, QIODevice::WriteOnly);
+        QByteArray header;
+        QDataStream out(&header, QIODevice::WriteOnly);
+        if (requestId >= 0)
+            out << static_cast<qint32>(requestId);
         out << exitCode;
-        out.writeRawData( message.constData(), message.length() );
-        writeMessage(client, msg);
-        if (exitCode == CommandFinished) {
+        writeMessage( client, QList<QByteArray>() << header << message );
+        if (requestId >= 0) {
+            // Session is kept open.
+        } else if (exitCode == CommandFinished) {
             connect(client, SIGNAL(disconnected()),
                     client, SLOT(deleteLater()));
             COPYQ_LOG( QString("%1: Disconnected from client.").arg(id) );
         } else if (exitCode == CommandExit) {
-            client->flush();
+            MessageWriter::writer(client)->flush();
             QApplication::exit(0);
         }
         COPYQ_LOG( QString("%1: Message send to client.").arg(id) );
     } else {
         COPYQ_LOG( QString("%1: Client disconnected!").arg(id) );
     }
+
+    // Delete disconnected session client after last command finished.
+    if (requestId >= 0 && exitCode == CommandFinished) {
+        QHash<QLocalSocket*, int>::iterator it = m_sessionRequests.find(client);
+        if ( it != m_sessionRequests.end() && --it.value() == 0
+             && client->state() != QLocalSocket::ConnectedState )
+        {
+            m_sessionRequests.erase(it);
+            client->deleteLater();
+        }
+    }
 }
 
 void ClipboardServer::newMonitorMessage(const QByteArray &message)
 {
     COPYQ_LOG("Receiving message from monitor.");
 
+    QMimeData *data = new QMimeData;
+    QStringList sharedKeys;
+    const bool ok = MimeDataCodec::deserialize(message, data, &sharedKeys);
+
+    // Monitor can release shared memory after the data were copied.
+    if ( !sharedKeys.isEmpty() )
+        m_monitor->writeMessage( MimeDataCodec::releaseMessage(sharedKeys) );
+
+    if (!ok) {
+        delete data;
+        log( tr("Cannot read clipboard data from monitor!"), LogError );
+        return;
+    }
+
+    if ( m_monitorCodec.release(*data) ) {
+        delete data;
+        return;
+    }
+
+    const QByteArray manifestData = data->data(mimeClipboardManifest);
+    if ( !manifestData.isEmpty() ) {
+        delete data;
+        QDataStream manifestIn(manifestData);
+        QVariantMap manifest;
+        manifestIn >> manifest;
+        // Skip retrieving data which are already the first item.
+        if ( manifest.value("fingerprint") == m_lastFingerprint && isLastClipboardItem(m_lastHash) )
+            COPYQ_LOG("Clipboard data didn't change.");
+        else
+            requestClipboardData(manifest);
+        return;
+    }
+
+    const QByteArray touchedData = data->data(mimeClipboardTouched);
+    if ( !touchedData.isEmpty() ) {
+        delete data;
+        QDataStream touchedIn(touchedData);
+        QVariantMap touched;
+        touchedIn >> touched;
+        // Data need to be added again if the item was removed or moved in the meantime.
+        if ( !m_checkclip || isLastClipboardItem(touched.value("hash").toUInt()) )
+            COPYQ_LOG("Clipboard data set again without change.");
+        else
+            requestClipboardData(touched);
+        return;
+    }
+
     ClipboardItem item;
-    QDataStream in(message);
-    in >> item;
+    item.setData(data);
 
     m_wnd->clipboardChanged(&item);
 
-    if ( m_checkclip && !item.isEmpty() && m_lastHash != item.dataHash() ) {
-        m_lastHash = item.dataHash();
-        m_wnd->addToTab( item.data(), QString(), true );
+    if ( m_checkclip && !item.isEmpty() ) {
+        if ( !isLastClipboardItem(item.dataHash()) ) {
+            m_lastHash = item.dataHash();
+            m_wnd->addToTab( item.data(), QString(), true );
+        }
+        m_lastFingerprint = m_requestedFingerprint;
+    } else {
+        m_lastFingerprint.clear();
     }
 
     COPYQ_LOG("Message received from monitor.");
 }
 
+void ClipboardServer::requestClipboardData(const QVariantMap &manifest)
+{
+    // Request only formats which are stored in items.
+    const QStringList formatsToSave = ItemFactory::instance()->formatsToSave();
+    QStringList formats;
+    foreach ( const QString &format, manifest.value("formats").toStringList() ) {
+        if ( formatsToSave.contains(format) )
+            formats.append(format);
+    }
+
+    m_requestedFingerprint = manifest.value("fingerprint");
+
+    QVariantMap request;
+    request["id"] = manifest.value("id");
+    request["formats"] = formats;
+
+    QByteArray requestData;
+    QDataStream requestOut(&requestData, QIODevice::WriteOnly);
+    requestOut << request;
+
+    QMimeData data;
+    data.setData(mimeClipboardRequest, requestData);
+    m_monitor->writeMessage( m_monitorCodec.serialize(data) );
+}
+
+bool ClipboardServer::isLastClipboardItem(uint itemHash)
+{
+    if (m_lastHash != itemHash)
+        return false;
+
+    ClipboardBrowser *c = m_wnd->browser(0);
+    c->loadItems();
+    return c->length() > 0 && c->at(0)->dataHash() == itemHash;
+}
+
 void ClipboardServer::monitorConnectionError()
 {
     stopMonitoring();
@@ -327,18 +506,26 @@ void ClipboardServer::changeClipboard(const ClipboardItem *item)
 
     COPYQ_LOG("Sending message to monitor.");
 
-    QByteArray msg;
-    QDataStream out(&msg, QIODevice::WriteOnly);
-    out << *item;
-    m_monitor->writeMessage(msg);
+    const QMimeData *data = item->data();
+    m_monitor->writeMessage( m_monitorCodec.serialize(*data) );
     m_lastHash = item->dataHash();
+
+    QStringList formats;
+    foreach ( const QString &format, ItemFactory::instance()->formatsToSave() ) {
+        if ( data->hasFormat(format) )
+            formats.append(format);
+    }
+    m_lastFingerprint = fingerprint(*data, formats);
 }
 
-void ClipboardServer::doCommand(const Arguments &args, QLocalSocket *client)
+void ClipboardServer::doCommand(const Arguments &args, QLocalSocket *client, int requestId)
 {
     // Worker object without parent needs to be deleted afterwards!
     // There is no parent so as it's possible to move the worker to another thread.
-    ScriptableWorker *worker = new ScriptableWorker(m_wnd, args, client);
+    ScriptableWorker *worker = new ScriptableWorker(m_wnd, args, client, requestId);
+
+    if (requestId >= 0)
+        ++m_sessionRequests[client];
 
     // Delete worker after it's finished.
     connect(worker, SIGNAL(finished()), worker, SLOT(deleteLater()));
@@ -350,8 +537,18 @@ void ClipboardServer::doCommand(const Arguments &args, QLocalSocket *client)
     if (client != NULL) {
         connect(client, SIGNAL(disconnected()),
                 worker, SLOT(terminate()));
-        connect(worker, SIGNAL(sendMessage(QLocalSocket*,QByteArray,int)),
-                this, SLOT(sendMessage(QLocalSocket*,QByteArray,int)));
+        connect(worker, SIGNAL(sendMessage(QLocalSocket*,QByteArray,int,int)),
+                this, SLOT(sendMessage(QLocalSocket*,QByteArray,int,int)));
+        connect(MessageWriter::writer(client), SIGNAL(written(qint64)),
+                worker, SLOT(onMessagesWritten(qint64)));
+
+        if (requestId < 0) {
+            MessageReader *reader = client->findChild<MessageReader*>();
+            if (reader != NULL) {
+                connect( reader, SIGNAL(messageReceived(QByteArray)),
+                         worker, SLOT(addInput(QByteArray)) );
+            }
+        }
 
         // Add client thread to pool.
         m_clientThreads.start(worker);
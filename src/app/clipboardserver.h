@@ -22,10 +22,13 @@
 
 #include "app.h"
 #include "common/client_server.h"
+#include "common/mimedatacodec.h"
 
+#include <QHash>
 #include <QMap>
 #include <QProcess>
 #include <QThreadPool>
+#include <QVariantMap>
 
 class Arguments;
 class ClipboardBrowser;
@@ -59,7 +62,8 @@ public:
      */
     void doCommand(
             const Arguments &args, //!< Contains command and its arguments.
-            QLocalSocket *client = NULL //!< For sending responses.
+            QLocalSocket *client = NULL, //!< For sending responses.
+            int requestId = -1 //!< Request ID in client session (negative if not in session).
             );
 
     /** Stop monitor application. */
@@ -95,13 +99,23 @@ signals:
     void terminateClientThreads();
 
 private:
+    /** Return true if data with @a itemHash are the last clipboard and still the first item. */
+    bool isLastClipboardItem(uint itemHash);
+
     QLocalServer *m_server;
     MainWindow* m_wnd;
     RemoteProcess *m_monitor;
+    MimeDataCodec m_monitorCodec;
     bool m_checkclip;
     uint m_lastHash;
+    /** Fingerprint of last clipboard data with m_lastHash (see fingerprint()). */
+    QVariant m_lastFingerprint;
+    /** Fingerprint from manifest of last requested clipboard data. */
+    QVariant m_requestedFingerprint;
     QMap<QxtGlobalShortcut*, Arguments> m_shortcutActions;
     QThreadPool m_clientThreads;
+    /** Number of running commands for each client session. */
+    QHash<QLocalSocket*, int> m_sessionRequests;
 
 public slots:
     /** Load @a item data to clipboard. */
@@ -114,9 +128,28 @@ private slots:
     /** A new client connected. */
     void newConnection();
 
+    /** Command message received from client (sender is MessageReader of the client). */
+    void newClientMessage(const QByteArray &message);
+
+    /** Cannot read command message from client. */
+    void clientReadError();
+
+    /** Command message with request ID received from client session. */
+    void newSessionMessage(const QByteArray &message);
+
+    /** Client session disconnected. */
+    void sessionDisconnected();
+
     /** New message from monitor process. */
     void newMonitorMessage(const QByteArray &message);
 
+    /**
+     * Request clipboard data described by @a manifest from monitor.
+     *
+     * Only formats which are saved in items are requested.
+     */
+    void requestClipboardData(const QVariantMap &manifest);
+
     /** An error occurred on monitor connection. */
     void monitorConnectionError();
 
@@ -133,7 +166,8 @@ private slots:
     void sendMessage(
             QLocalSocket* client, //!< Client socket.
             const QByteArray &message, //!< Message for client.
-            int exitCode = 0 //!< Exit code for client (non-zero for an error).
+            int exitCode = 0, //!< Exit code for client (non-zero for an error).
+            int requestId = -1 //!< Request ID in client session (negative if not in session).
             );
 };
 
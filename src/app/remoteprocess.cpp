@@ -20,6 +20,7 @@
 #include "remoteprocess.h"
 
 #include "common/client_server.h"
+#include "common/messagereader.h"
 
 #include <QCoreApplication>
 #include <QByteArray>
@@ -59,8 +60,11 @@ void RemoteProcess::start(const QString &newServerName, const QStringList &argum
     if ( m_process.waitForStarted(2000) && m_server->waitForNewConnection(2000) ) {
         COPYQ_LOG("Remote process: Started.");
         m_socket = m_server->nextPendingConnection();
-        connect( m_socket, SIGNAL(readyRead()),
-                 this, SLOT(readyRead()) );
+        MessageReader *reader = new MessageReader(m_socket);
+        connect( reader, SIGNAL(messageReceived(QByteArray)),
+                 this, SIGNAL(newMessage(QByteArray)) );
+        connect( reader, SIGNAL(readError()),
+                 this, SLOT(onReadError()) );
     } else {
         log( "Remote process: Failed to start new remote process!", LogError );
     }
@@ -114,23 +118,8 @@ void RemoteProcess::closeConnection()
     }
 }
 
-void RemoteProcess::readyRead()
+void RemoteProcess::onReadError()
 {
-    Q_ASSERT(m_server != NULL);
-    Q_ASSERT(m_socket != NULL);
-    Q_ASSERT(isConnected());
-
-    m_socket->blockSignals(true);
-
-    while ( m_socket->bytesAvailable() > 0 ) {
-        QByteArray msg;
-        if( !::readMessage(m_socket, &msg) ) {
-            log( "Incorrect message from remote process.", LogError );
-            emit connectionError();
-            return;
-        }
-        emit newMessage(msg);
-    }
-
-    m_socket->blockSignals(false);
+    log( "Incorrect message from remote process.", LogError );
+    emit connectionError();
 }
@@ -70,7 +70,7 @@ signals:
     void connectionError();
 
 private slots:
-    void readyRead();
+    void onReadError();
 
 private:
     QProcess m_process;
@@ -19,6 +19,48 @@
 
 #include "action.h"
 
+#include <QTextCodec>
+#include <QTimer>
+
+namespace {
+
+/// Interval for emitting items (output of command is usually read in many small chunks).
+const int emitItemsIntervalMs = 100;
+
+/**
+ * Return literal text if regular expression @a pattern matches only that text,
+ * otherwise return null string.
+ */
+QString literalPattern(const QString &pattern)
+{
+    const QString special("\\^$.|?*+()[]{}");
+    QString literal;
+
+    for (int i = 0; i < pattern.size(); ++i) {
+        QChar c = pattern[i];
+        if (c == '\\') {
+            if (++i == pattern.size())
+                return QString();
+            c = pattern[i];
+            if (c == 'n')
+                c = '\n';
+            else if (c == 't')
+                c = '\t';
+            else if (c == 'r')
+                c = '\r';
+            else if ( !special.contains(c) )
+                return QString();
+        } else if ( special.contains(c) ) {
+            return QString();
+        }
+        literal.append(c);
+    }
+
+    return literal;
+}
+
+} // namespace
+
 Action::Action(const Commands &cmd,
                const QByteArray &input, const QString &outputItemFormat,
                const QString &itemSeparator,
@@ -26,15 +68,25 @@ Action::Action(const Commands &cmd,
     : QProcess()
     , m_input(input)
     , m_sep(index.isValid() ? QString() : itemSeparator)
+    , m_literalSep( literalPattern(m_sep.pattern()) )
     , m_cmds(cmd)
     , m_tab(outputTabName)
     , m_outputFormat(outputItemFormat != "text/plain" ? outputItemFormat : QString())
     , m_index(index)
     , m_errstr()
     , m_lastOutput()
+    , m_searchPos(0)
+    , m_decoder( QTextCodec::codecForLocale()->makeDecoder() )
+    , m_items()
+    , m_timerEmitItems( new QTimer(this) )
     , m_failed(false)
     , m_firstProcess(NULL)
 {
+    m_timerEmitItems->setSingleShot(true);
+    m_timerEmitItems->setInterval(emitItemsIntervalMs);
+    connect( m_timerEmitItems, SIGNAL(timeout()),
+             SLOT(emitItems()) );
+
     setProcessChannelMode(QProcess::SeparateChannels);
     connect( this, SIGNAL(error(QProcess::ProcessError)),
              SLOT(actionError(QProcess::ProcessError)) );
@@ -51,6 +103,11 @@ Action::Action(const Commands &cmd,
     }
 }
 
+Action::~Action()
+{
+    delete m_decoder;
+}
+
 QString Action::command() const
 {
     QString text;
@@ -64,8 +121,11 @@ QString Action::command() const
 
 void Action::start()
 {
-    if ( m_cmds.isEmpty() )
+    // Action must finish so it's not left running (e.g. in ActionScheduler).
+    if ( m_cmds.isEmpty() ) {
+        emit actionFinished(this);
         return;
+    }
 
     if ( m_cmds.size() > 1 ) {
         QProcess *lastProcess = new QProcess(this);
@@ -121,15 +181,9 @@ void Action::actionFinished()
         }
     } else if ( !m_lastOutput.isNull() ) {
         actionOutput();
-        if ( !m_lastOutput.isNull() ) {
-            QStringList items;
-            items.append(m_lastOutput);
-            if (m_index.isValid())
-                emit newItems(items, m_index);
-            else
-                emit newItems(items, m_tab);
-            m_lastOutput = QString();
-        }
+        m_items.append(m_lastOutput);
+        m_lastOutput = QString();
+        emitItems();
     }
 
     emit actionFinished(this);
@@ -142,18 +196,40 @@ void Action::actionOutput()
         return;
     }
 
-    m_lastOutput.append( QString::fromLocal8Bit(readAll()) );
+    const QByteArray bytes = readAll();
+    if ( bytes.isEmpty() )
+        return;
+
+    m_lastOutput.append( m_decoder->toUnicode(bytes) );
     if ( m_lastOutput.isEmpty() || m_sep.isEmpty() )
         return;
 
-    // Split to items.
-    QStringList items;
-    items = m_lastOutput.split(m_sep);
-    m_lastOutput = items.takeLast();
-    if (m_index.isValid())
-        emit newItems(items, m_index);
-    else
-        emit newItems(items, m_tab);
+    // Split to items. Search only new output for literal separator; regular
+    // expression could match differently with more text so search from start.
+    int start = 0;
+    if ( !m_literalSep.isNull() ) {
+        int end;
+        while ( (end = m_lastOutput.indexOf(m_literalSep, m_searchPos)) != -1 ) {
+            m_items.append( m_lastOutput.mid(start, end - start) );
+            start = m_searchPos = end + m_literalSep.size();
+        }
+    } else {
+        // Same as QString::split().
+        int extra = 0;
+        int end;
+        while ( (end = m_sep.indexIn(m_lastOutput, start + extra)) != -1 ) {
+            const int matchedLength = m_sep.matchedLength();
+            m_items.append( m_lastOutput.mid(start, end - start) );
+            start = end + matchedLength;
+            extra = (matchedLength == 0) ? 1 : 0;
+        }
+    }
+
+    m_lastOutput.remove(0, start);
+    m_searchPos = qMax(0, m_lastOutput.size() - m_literalSep.size() + 1);
+
+    if ( !m_items.isEmpty() && !m_timerEmitItems->isActive() )
+        m_timerEmitItems->start();
 }
 
 void Action::actionErrorOutput()
@@ -161,6 +237,21 @@ void Action::actionErrorOutput()
     m_errstr += QString::fromLocal8Bit( readAllStandardError() );
 }
 
+void Action::emitItems()
+{
+    m_timerEmitItems->stop();
+
+    if ( m_items.isEmpty() )
+        return;
+
+    if (m_index.isValid())
+        emit newItems(m_items, m_index);
+    else
+        emit newItems(m_items, m_tab);
+
+    m_items.clear();
+}
+
 void Action::terminate()
 {
     // try to terminate process
@@ -25,6 +25,8 @@
 #include <QStringList>
 
 class QAction;
+class QTextDecoder;
+class QTimer;
 
 /**
  * Execute external program.
@@ -46,6 +48,8 @@ public:
             const QModelIndex &index //!< Output item index.
             );
 
+    ~Action();
+
     /** Return true only if command execution failed. */
     bool actionFailed() const { return m_failed; }
 
@@ -61,18 +65,23 @@ public:
     /** Return input. */
     const QByteArray &input() const { return m_input; }
 
-    /** Execute command. */
+    /** Execute command (if there is no command, actionFinished() is emitted immediately). */
     void start();
 
 private:
     const QByteArray m_input;
     const QRegExp m_sep;
+    const QString m_literalSep; //!< Separator if it's not regular expression (otherwise null).
     const Commands m_cmds;
     const QString m_tab;
     const QString m_outputFormat;
     const QModelIndex m_index;
     QString m_errstr;
-    QString m_lastOutput;
+    QString m_lastOutput; //!< Output after last separator.
+    int m_searchPos; //!< Position in m_lastOutput to continue search for literal separator.
+    QTextDecoder *m_decoder; //!< Decodes output which can be split in middle of character.
+    QStringList m_items; //!< Items not emitted yet.
+    QTimer *m_timerEmitItems; //!< Emits items in batches.
     QByteArray m_outputData;
     bool m_failed;
     QProcess *m_firstProcess; //!< First process in pipe.
@@ -83,6 +92,8 @@ private slots:
     void actionFinished();
     void actionOutput();
     void actionErrorOutput();
+    /** Emit items read so far. */
+    void emitItems();
 
 public slots:
     /** Terminate (kill) process. */
@@ -0,0 +1,130 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "actionscheduler.h"
+
+#include "common/action.h"
+#include "common/client_server.h"
+
+ActionScheduler::ActionScheduler(QObject *parent)
+    : QObject(parent)
+    , m_running()
+    , m_maxRunning(1)
+    , m_totalWaitMs(0)
+    , m_waitedCount(0)
+{
+}
+
+ActionScheduler::~ActionScheduler()
+{
+    for (int i = 0; i < PriorityCount; ++i) {
+        foreach (const QueuedAction &queued, m_queues[i])
+            delete queued.action;
+    }
+}
+
+void ActionScheduler::setMaxRunningActions(int count)
+{
+    m_maxRunning = qMax(1, count);
+    startQueuedActions();
+    emit queueChanged();
+}
+
+void ActionScheduler::addAction(Action *action, Priority priority)
+{
+    if ( m_running.size() < m_maxRunning && queuedActionCount() == 0 ) {
+        startAction(action);
+    } else {
+        COPYQ_LOG( QString("Queuing command: %1").arg(action->command()) );
+        QueuedAction queued;
+        queued.action = action;
+        queued.waiting.start();
+        m_queues[priority].append(queued);
+    }
+
+    emit queueChanged();
+}
+
+void ActionScheduler::cancelQueuedActions()
+{
+    if ( queuedActionCount() == 0 )
+        return;
+
+    COPYQ_LOG( QString("Canceling %1 queued commands").arg(queuedActionCount()) );
+
+    for (int i = 0; i < PriorityCount; ++i) {
+        foreach (const QueuedAction &queued, m_queues[i])
+            queued.action->deleteLater();
+        m_queues[i].clear();
+    }
+
+    emit queueChanged();
+}
+
+int ActionScheduler::queuedActionCount() const
+{
+    int count = 0;
+    for (int i = 0; i < PriorityCount; ++i)
+        count += m_queues[i].size();
+    return count;
+}
+
+qint64 ActionScheduler::longestWaitMs() const
+{
+    qint64 waitMs = 0;
+    for (int i = 0; i < PriorityCount; ++i) {
+        if ( !m_queues[i].isEmpty() )
+            waitMs = qMax( waitMs, m_queues[i].first().waiting.elapsed() );
+    }
+    return waitMs;
+}
+
+qint64 ActionScheduler::averageWaitMs() const
+{
+    return m_waitedCount > 0 ? m_totalWaitMs / m_waitedCount : 0;
+}
+
+void ActionScheduler::onActionFinished(Action *action)
+{
+    if ( m_running.remove(action) ) {
+        startQueuedActions();
+        emit queueChanged();
+    }
+}
+
+void ActionScheduler::startAction(Action *action)
+{
+    connect( action, SIGNAL(actionFinished(Action*)),
+             this, SLOT(onActionFinished(Action*)) );
+    m_running.insert(action);
+    action->start();
+}
+
+void ActionScheduler::startQueuedActions()
+{
+    for (int i = 0; i < PriorityCount; ++i) {
+        QList<QueuedAction> &queue = m_queues[i];
+        while ( m_running.size() < m_maxRunning && !queue.isEmpty() ) {
+            const QueuedAction queued = queue.takeFirst();
+            m_totalWaitMs += queued.waiting.elapsed();
+            ++m_waitedCount;
+            startAction(queued.action);
+        }
+    }
+}
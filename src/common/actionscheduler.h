@@ -0,0 +1,97 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ACTIONSCHEDULER_H
+#define ACTIONSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QSet>
+
+class Action;
+
+/**
+ * Starts actions so that only limited number of them runs at the same time.
+ *
+ * Other actions wait in queue. Actions started by user are started before
+ * automatic ones, otherwise actions are started in order they were added.
+ */
+class ActionScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    enum Priority {
+        PriorityInteractive,
+        PriorityAutomatic,
+        PriorityCount
+    };
+
+    explicit ActionScheduler(QObject *parent = NULL);
+
+    /** Deletes queued actions. */
+    ~ActionScheduler();
+
+    /** Set maximum number of actions running at the same time (at least one). */
+    void setMaxRunningActions(int count);
+
+    /** Start @a action or add it to queue if too many actions are running. */
+    void addAction(Action *action, Priority priority);
+
+    /** Remove all actions from queue and delete them. */
+    void cancelQueuedActions();
+
+    int runningActionCount() const { return m_running.size(); }
+
+    int queuedActionCount(Priority priority) const { return m_queues[priority].size(); }
+
+    int queuedActionCount() const;
+
+    /** Return how long (in milliseconds) the oldest action in queue waits. */
+    qint64 longestWaitMs() const;
+
+    /** Return average time (in milliseconds) queued actions waited before they started. */
+    qint64 averageWaitMs() const;
+
+signals:
+    /** Emitted when number of running or queued actions changes. */
+    void queueChanged();
+
+private slots:
+    void onActionFinished(Action *action);
+
+private:
+    struct QueuedAction {
+        Action *action;
+        QElapsedTimer waiting;
+    };
+
+    void startAction(Action *action);
+
+    /** Start queued actions while there are free slots. */
+    void startQueuedActions();
+
+    QList<QueuedAction> m_queues[PriorityCount];
+    QSet<Action *> m_running;
+    int m_maxRunning;
+    qint64 m_totalWaitMs;
+    int m_waitedCount;
+};
+
+#endif // ACTIONSCHEDULER_H
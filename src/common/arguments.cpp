@@ -71,6 +71,7 @@ Arguments::Arguments(int argc, char **argv, int skipArgc)
 
     /* Special arguments:
      * "-"  read this argument from stdin
+     *      (except for "importtab" and "importjson" which read stdin in chunks requested by server)
      * "--" read all following arguments without control sequences
      */
     bool readRaw = false;
@@ -81,6 +82,12 @@ Arguments::Arguments(int argc, char **argv, int skipArgc)
         } else {
             if ( arg[0] == '-' ) {
                 if ( arg[1] == '\0' ) {
+                    if ( !m_args.isEmpty()
+                         && (m_args.last() == "importtab" || m_args.last() == "importjson") )
+                    {
+                        m_args.append("-");
+                        continue;
+                    }
                     QFile in;
                     in.open(stdin, QIODevice::ReadOnly);
                     m_args.append( in.readAll() );
@@ -117,6 +124,11 @@ void Arguments::append(const QByteArray &argument)
     m_args.append(argument);
 }
 
+void Arguments::appendEscaped(const QByteArray &argument)
+{
+    addArgumentFromCommandLine( m_args, argument.constData(), m_args.size() );
+}
+
 const QByteArray &Arguments::at(int index) const
 {
     return m_args.at(index);
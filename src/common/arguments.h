@@ -50,6 +50,9 @@ public:
     /** Append argument. */
     void append(const QByteArray &argument);
 
+    /** Append argument with escape sequences (\n, \t, \\) as on command line. */
+    void appendEscaped(const QByteArray &argument);
+
     /** Get argument by @a index. */
     const QByteArray &at(int index) const;
 
@@ -19,6 +19,8 @@
 
 #include "common/client_server.h"
 
+#include "common/messagewriter.h"
+
 #include <QAction>
 #include <QApplication>
 #include <QClipboard>
@@ -27,6 +29,7 @@
 #include <QLocalSocket>
 #include <QMimeData>
 #include <QObject>
+#include <QStringList>
 #include <QThread>
 #if QT_VERSION < 0x050000
 #   include <QTextDocument> // Qt::escape()
@@ -34,6 +37,10 @@
 
 const QString mimeWindowTitle = "application/x-copyq-owner-window-title";
 const QString mimeItemNotes = "application/x-copyq-item-notes";
+const QString mimeClipboardManifest = "application/x-copyq-clipboard-manifest";
+const QString mimeClipboardRequest = "application/x-copyq-clipboard-request";
+const QString mimeClipboardTouched = "application/x-copyq-clipboard-touched";
+const QString sessionArgument = "--session-stdin";
 
 QString escapeHtml(const QString &str)
 {
@@ -82,54 +89,14 @@ const QMimeData *clipboardData(QClipboard::Mode mode)
     return data;
 }
 
-bool readBytes(QIODevice *socket, qint64 size, QByteArray *bytes)
-{
-    qint64 avail, read = 0;
-    bytes->clear();
-    while (read < size) {
-        if ( socket->bytesAvailable() == 0 && !socket->waitForReadyRead(1000) )
-            return false;
-        avail = qMin( socket->bytesAvailable(), size-read );
-        bytes->append( socket->read(avail) );
-        read += avail;
-    }
-
-    return true;
-}
-
-bool readMessage(QIODevice *socket, QByteArray *msg)
+void writeMessage(QIODevice *socket, const QByteArray &msg)
 {
-    QByteArray bytes;
-    quint32 len;
-
-    COPYQ_LOG("Reading message.");
-
-    if ( readBytes(socket, sizeof(len), &bytes) ) {
-        QDataStream(bytes) >> len;
-
-        if ( readBytes(socket, len, msg) ) {
-            COPYQ_LOG( QString("Message read (%1 bytes).").arg(msg->size()) );
-            return true;
-        }
-    }
-
-    COPYQ_LOG("ERROR: Incorrect message!");
-
-    return false;
+    writeMessage( socket, QList<QByteArray>() << msg );
 }
 
-void writeMessage(QIODevice *socket, const QByteArray &msg)
+void writeMessage(QIODevice *socket, const QList<QByteArray> &parts)
 {
-    COPYQ_LOG( QString("Write message (%1 bytes).").arg(msg.size()) );
-
-    QDataStream out(socket);
-    // length is serialized as a quint32, followed by msg
-    out.writeBytes( msg.constData(), msg.length() );
-
-    if (out.status() == QDataStream::Ok)
-        COPYQ_LOG("Message written.");
-    else
-        log( "Cannot write message!", LogError );
+    MessageWriter::writer(socket)->write(parts);
 }
 
 QLocalServer *newServer(const QString &name, QObject *parent)
@@ -189,6 +156,19 @@ uint hash(const QMimeData &data, const QStringList &formats)
     return hash;
 }
 
+uint fingerprint(const QMimeData &data, const QStringList &formats)
+{
+    QStringList keyFormats;
+    foreach ( const QString &mime, formats ) {
+        if ( mime.startsWith("text/") )
+            keyFormats.append(mime);
+    }
+    if ( keyFormats.isEmpty() && !formats.isEmpty() )
+        keyFormats.append( formats.first() );
+
+    return hash(data, keyFormats) ^ qHash( formats.join("\n") );
+}
+
 QMimeData *cloneData(const QMimeData &data, const QStringList *formats)
 {
     QMimeData *newdata = new QMimeData;
@@ -23,6 +23,7 @@
 #include <QClipboard>
 #include <QFont>
 #include <QFontMetrics>
+#include <QList>
 #include <QtGlobal> // Q_WS_*
 
 // Application version
@@ -49,7 +50,9 @@ typedef enum {
     /** Activate window */
     CommandActivateWindow,
     /** Command to exit application. */
-    CommandExit
+    CommandExit,
+    /** Request for next chunk of client's standard input (empty chunk is sent at end). */
+    CommandReadInput
 } CommandStatus;
 
 #if QT_VERSION < 0x050000
@@ -81,6 +84,12 @@ enum LogLevel {
 
 extern const QString mimeWindowTitle;
 extern const QString mimeItemNotes;
+extern const QString mimeClipboardManifest;
+extern const QString mimeClipboardRequest;
+extern const QString mimeClipboardTouched;
+
+/** Client argument to start session reading commands from standard input. */
+extern const QString sessionArgument;
 
 QString escapeHtml(const QString &str);
 
@@ -90,9 +99,18 @@ bool isMainThread();
 
 const QMimeData *clipboardData(QClipboard::Mode mode = QClipboard::Clipboard);
 
-bool readBytes(QIODevice *socket, qint64 size, QByteArray *bytes);
-bool readMessage(QIODevice *socket, QByteArray *msg);
+/** Maximum size of message chunk (larger messages are split to multiple chunks). */
+const int messageChunkBytes = 256 * 1024;
+/** Flag in length of message chunk if more chunks of the message follow. */
+const quint32 messageChunkFlag = 0x80000000;
+
+/**
+ * Queue message for writing to @a socket (use MessageReader to read it).
+ * @see MessageWriter
+ */
 void writeMessage(QIODevice *socket, const QByteArray &msg);
+/** Queue single message consisting of @a parts without joining them first. */
+void writeMessage(QIODevice *socket, const QList<QByteArray> &parts);
 
 QLocalServer *newServer(const QString &name, QObject *parent=NULL);
 QString serverName(const QString &name);
@@ -101,6 +119,14 @@ QString clipboardMonitorServerName();
 
 uint hash(const QMimeData &data, const QStringList &formats);
 
+/**
+ * Return fingerprint of @a data available in @a formats.
+ *
+ * Unlike hash(), only text formats are read (or the first format if there is
+ * no text) so it's cheap to compute even for data owned by other application.
+ */
+uint fingerprint(const QMimeData &data, const QStringList &formats);
+
 QMimeData *cloneData(const QMimeData &data, const QStringList *formats=NULL);
 
 QString elideText(const QString &text, int maxLength, const QFontMetrics &fm = QFontMetrics(QFont()));
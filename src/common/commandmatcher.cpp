@@ -0,0 +1,331 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "commandmatcher.h"
+
+#include "common/client_server.h"
+#include "common/command.h"
+
+#include <QElapsedTimer>
+#include <QMimeData>
+#include <QPair>
+#include <QStringList>
+
+#include <algorithm>
+
+namespace {
+
+/// Longer text and window title is truncated before matching.
+const int maxMatchedTextLength = 64 * 1024;
+
+/// Log commands which take longer to match.
+const qint64 slowMatchNs = 10 * 1000 * 1000;
+
+/** Return value of hexadecimal (if @a base is 16) or octal digit @a c or -1 if it's not a digit. */
+int digitValue(QChar c, int base)
+{
+    const int value = c.isDigit() ? c.digitValue()
+                    : (c >= 'a' && c <= 'f') ? c.unicode() - 'a' + 10
+                    : (c >= 'A' && c <= 'F') ? c.unicode() - 'A' + 10
+                    : -1;
+    return value < base ? value : -1;
+}
+
+/**
+ * Return longest text which must be part of any match of regular expression
+ * @a pattern (empty string if there is no such text or it's hard to find).
+ *
+ * @a isLiteral is set to true only if the expression matches just the returned text.
+ */
+QString requiredLiteral(const QString &pattern, bool *isLiteral)
+{
+    *isLiteral = false;
+
+    // Alternatives would need more complex analysis.
+    for (int i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] == '\\')
+            ++i;
+        else if (pattern[i] == '|')
+            return QString();
+    }
+
+    QString best;
+    QString run;
+    bool lastIsLiteral = false;
+    bool onlyLiterals = true;
+    int depth = 0;
+
+    for (int i = 0; i < pattern.size(); ++i) {
+        const QChar c = pattern[i];
+        QChar literal;
+        bool hasLiteral = false;
+
+        if (c == '\\') {
+            if (++i == pattern.size())
+                return QString();
+            const QChar escaped = pattern[i];
+            hasLiteral = true;
+            if (escaped == 'n') {
+                literal = '\n';
+            } else if (escaped == 't') {
+                literal = '\t';
+            } else if (escaped == 'r') {
+                literal = '\r';
+            } else if (escaped == 'f') {
+                literal = '\f';
+            } else if (escaped == 'v') {
+                literal = '\v';
+            } else if (escaped == 'a') {
+                literal = '\a';
+            } else if (escaped == 'x' || escaped == '0') {
+                // Character code \xhhhh (hexadecimal) or \0ooo (octal).
+                const int base = (escaped == 'x') ? 16 : 8;
+                const int maxDigits = (escaped == 'x') ? 4 : 3;
+                int code = 0;
+                int digits = 0;
+                for ( ; digits < maxDigits && i + 1 < pattern.size(); ++digits ) {
+                    const int value = digitValue(pattern[i + 1], base);
+                    if (value == -1)
+                        break;
+                    code = code * base + value;
+                    ++i;
+                }
+                if (escaped == 'x' && digits == 0)
+                    hasLiteral = false;
+                else
+                    literal = QChar(code);
+            } else if ( escaped.isDigit() ) {
+                // Skip back-reference.
+                while ( i + 1 < pattern.size() && pattern[i + 1].isDigit() )
+                    ++i;
+                hasLiteral = false;
+            } else if ( !escaped.isLetterOrNumber() ) {
+                literal = escaped;
+            } else {
+                // Character class or assertion (e.g. \d, \w, \b).
+                hasLiteral = false;
+            }
+        } else if (c == '[') {
+            // Skip character class.
+            ++i;
+            if (i < pattern.size() && pattern[i] == '^')
+                ++i;
+            if (i < pattern.size() && pattern[i] == ']')
+                ++i;
+            while (i < pattern.size() && pattern[i] != ']') {
+                if (pattern[i] == '\\')
+                    ++i;
+                ++i;
+            }
+        } else if (c == '(') {
+            ++depth;
+        } else if (c == ')') {
+            --depth;
+        } else if (c == '?' || c == '*' || c == '{') {
+            // Previous character is optional.
+            if (lastIsLiteral)
+                run.chop(1);
+            if (c == '{') {
+                while (i < pattern.size() && pattern[i] != '}')
+                    ++i;
+            }
+        } else if (c != '+' && c != '.' && c != '^' && c != '$') {
+            literal = c;
+            hasLiteral = true;
+        }
+
+        if (hasLiteral && depth == 0) {
+            run.append(literal);
+            lastIsLiteral = true;
+        } else {
+            if ( run.size() > best.size() )
+                best = run;
+            run.clear();
+            lastIsLiteral = false;
+            onlyLiterals = false;
+        }
+    }
+
+    if ( run.size() > best.size() )
+        best = run;
+
+    *isLiteral = onlyLiterals;
+    return best;
+}
+
+bool moreExpensive(const QPair<qint64, QString> &lhs, const QPair<qint64, QString> &rhs)
+{
+    return lhs.first > rhs.first;
+}
+
+} // namespace
+
+bool CommandMatcher::Pattern::matches(const QString &text) const
+{
+    if ( !text.contains(literal, re.caseSensitivity()) )
+        return false;
+    return isLiteral || re.indexIn(text) != -1;
+}
+
+CommandMatcher::CompiledCommand::CompiledCommand()
+    : index(-1)
+    , name()
+    , re()
+    , wndre()
+    , remove(false)
+    , tested(0)
+    , matched(0)
+    , elapsedNs(0)
+{
+}
+
+CommandMatcher::CommandMatcher()
+    : m_commands()
+    , m_formatToCommands()
+    , m_anyFormat()
+{
+}
+
+CommandMatcher::~CommandMatcher()
+{
+    COPYQ_LOG( statistics() );
+}
+
+void CommandMatcher::setCommands(const QList<Command> &commands)
+{
+    COPYQ_LOG( statistics() );
+
+    m_commands.clear();
+    m_formatToCommands.clear();
+    m_anyFormat.clear();
+
+    for (int i = 0; i < commands.size(); ++i) {
+        const Command &c = commands[i];
+        if ( !c.automatic || (!c.remove && c.cmd.isEmpty() && c.tab.isEmpty()) )
+            continue;
+
+        CompiledCommand compiled;
+        compiled.index = i;
+        compiled.name = c.name.isEmpty() ? c.cmd : c.name;
+        compiled.re = compile(c.re);
+        compiled.wndre = compile(c.wndre);
+        compiled.remove = c.remove;
+
+        if ( c.input.isEmpty() )
+            m_anyFormat.append( m_commands.size() );
+        else
+            m_formatToCommands[c.input].append( m_commands.size() );
+
+        m_commands.append(compiled);
+    }
+}
+
+QList<int> CommandMatcher::match(const QMimeData &data)
+{
+    QList<int> candidates = m_anyFormat;
+    foreach ( const QString &format, data.formats() )
+        candidates.append( m_formatToCommands.value(format) );
+    if ( candidates.isEmpty() )
+        return QList<int>();
+    std::sort( candidates.begin(), candidates.end() );
+
+    const bool noText = !data.hasText();
+    QString text = noText ? QString() : data.text();
+    text.truncate(maxMatchedTextLength);
+    QString windowTitle = QString::fromUtf8( data.data(mimeWindowTitle).data() );
+    windowTitle.truncate(maxMatchedTextLength);
+
+    QList<int> matching;
+    QElapsedTimer timer;
+
+    foreach (int i, candidates) {
+        CompiledCommand &c = m_commands[i];
+
+        timer.start();
+        const bool matches =
+                ( (noText && c.re.re.isEmpty()) || (!noText && c.re.matches(text)) )
+                && ( windowTitle.isNull() || c.wndre.matches(windowTitle) );
+        const qint64 elapsedNs = timer.nsecsElapsed();
+
+        ++c.tested;
+        c.elapsedNs += elapsedNs;
+        if (elapsedNs > slowMatchNs) {
+            log( QString("Matching automatic command \"%1\" took %2 ms")
+                 .arg(c.name).arg(elapsedNs / 1000000), LogWarning );
+        }
+
+        if (matches) {
+            ++c.matched;
+            matching.append(c.index);
+            if (c.remove)
+                break;
+        }
+    }
+
+    return matching;
+}
+
+QString CommandMatcher::statistics() const
+{
+    QList< QPair<qint64, QString> > lines;
+    foreach (const CompiledCommand &c, m_commands) {
+        if (c.tested == 0)
+            continue;
+        lines.append( qMakePair(c.elapsedNs, QString("\"%1\": matched %2/%3, total %4 us, average %5 us")
+                                .arg(c.name)
+                                .arg(c.matched)
+                                .arg(c.tested)
+                                .arg(c.elapsedNs / 1000)
+                                .arg(c.elapsedNs / 1000 / c.tested)) );
+    }
+
+    if ( lines.isEmpty() )
+        return QString();
+
+    std::sort( lines.begin(), lines.end(), moreExpensive );
+
+    QStringList result("Automatic command matching statistics:");
+    for (int i = 0; i < lines.size(); ++i)
+        result.append(lines[i].second);
+    return result.join("\n");
+}
+
+CommandMatcher::Pattern CommandMatcher::compile(const QRegExp &re)
+{
+    Pattern pattern;
+    pattern.re = re;
+
+    if ( !re.isValid() )
+        return pattern;
+
+    switch ( re.patternSyntax() ) {
+    case QRegExp::RegExp:
+    case QRegExp::RegExp2:
+        pattern.literal = requiredLiteral( re.pattern(), &pattern.isLiteral );
+        break;
+    case QRegExp::FixedString:
+        pattern.literal = re.pattern();
+        pattern.isLiteral = true;
+        break;
+    default:
+        break;
+    }
+
+    return pattern;
+}
@@ -0,0 +1,96 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef COMMANDMATCHER_H
+#define COMMANDMATCHER_H
+
+#include <QHash>
+#include <QList>
+#include <QRegExp>
+#include <QString>
+
+class QMimeData;
+struct Command;
+
+/**
+ * Finds automatic commands matching new clipboard data.
+ *
+ * Commands are prepared once when they are set:
+ * - commands are indexed by input format so only commands for formats
+ *   available in data are tested,
+ * - text which every match of regular expression must contain is searched
+ *   before using the regular expression,
+ * - only beginning of long texts is matched.
+ *
+ * Time spent matching each command is measured (see statistics()).
+ */
+class CommandMatcher
+{
+public:
+    CommandMatcher();
+
+    ~CommandMatcher();
+
+    /** Prepare automatic commands (other commands are never matched). */
+    void setCommands(const QList<Command> &commands);
+
+    /**
+     * Return indexes (to list passed to setCommands()) of commands matching @a data
+     * in order. Commands after first matching command which removes item are omitted.
+     */
+    QList<int> match(const QMimeData &data);
+
+    /** Return time spent matching each command and number of matches. */
+    QString statistics() const;
+
+private:
+    /** Regular expression with text which each match must contain. */
+    struct Pattern {
+        Pattern() : re(), literal(), isLiteral(false) {}
+
+        bool matches(const QString &text) const;
+
+        QRegExp re;
+        QString literal;
+        bool isLiteral; //!< Regular expression matches only literal text.
+    };
+
+    struct CompiledCommand {
+        CompiledCommand();
+
+        int index;
+        QString name;
+        Pattern re;
+        Pattern wndre;
+        bool remove;
+
+        int tested;
+        int matched;
+        qint64 elapsedNs;
+    };
+
+    static Pattern compile(const QRegExp &re);
+
+    QList<CompiledCommand> m_commands;
+    /** Commands for input format (commands without input format are in m_anyFormat). */
+    QHash< QString, QList<int> > m_formatToCommands;
+    QList<int> m_anyFormat;
+};
+
+#endif // COMMANDMATCHER_H
@@ -33,6 +33,7 @@ enum {
     html,
     imageData,
     notes,
+    hash,
     firstFormat
 };
 
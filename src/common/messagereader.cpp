@@ -0,0 +1,114 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "messagereader.h"
+
+#include "common/client_server.h"
+
+#include <QIODevice>
+
+namespace {
+
+quint32 fromBigEndian(const char *bytes)
+{
+    const uchar *b = reinterpret_cast<const uchar *>(bytes);
+    return (quint32(b[0]) << 24) | (quint32(b[1]) << 16) | (quint32(b[2]) << 8) | quint32(b[3]);
+}
+
+} // namespace
+
+MessageReader::MessageReader(QIODevice *device)
+    : QObject(device)
+    , m_device(device)
+    , m_headerBytesRead(0)
+    , m_chunk()
+    , m_chunkBytesRead(0)
+    , m_readingChunk(false)
+    , m_lastChunk(true)
+    , m_message()
+    , m_streaming(false)
+{
+    Q_ASSERT(device != NULL);
+    connect( device, SIGNAL(readyRead()),
+             this, SLOT(readAvailable()) );
+}
+
+void MessageReader::readAvailable()
+{
+    // Device or this object can be deleted by receiver of messageReceived().
+    QPointer<MessageReader> self(this);
+
+    while ( self && m_device && m_device->bytesAvailable() > 0 ) {
+        if (!m_readingChunk) {
+            // Read chunk length (as written by QDataStream).
+            const qint64 read = m_device->read(
+                        m_header + m_headerBytesRead, sizeof(m_header) - m_headerBytesRead );
+            if (read < 0) {
+                emit readError();
+                return;
+            }
+
+            m_headerBytesRead += read;
+            if ( m_headerBytesRead < static_cast<int>(sizeof(m_header)) )
+                continue;
+
+            const quint32 length = fromBigEndian(m_header);
+            const quint32 chunkSize = length & ~messageChunkFlag;
+            if (chunkSize > static_cast<quint32>(messageChunkBytes)) {
+                log( "Incorrect message length!", LogError );
+                emit readError();
+                return;
+            }
+
+            m_headerBytesRead = 0;
+            m_chunk.resize(chunkSize);
+            m_chunkBytesRead = 0;
+            m_readingChunk = true;
+            m_lastChunk = (length & messageChunkFlag) == 0;
+        }
+
+        if ( m_chunkBytesRead < m_chunk.size() ) {
+            const qint64 read = m_device->read(
+                        m_chunk.data() + m_chunkBytesRead, m_chunk.size() - m_chunkBytesRead );
+            if (read < 0) {
+                emit readError();
+                return;
+            }
+            m_chunkBytesRead += read;
+        }
+
+        if ( m_chunkBytesRead == m_chunk.size() ) {
+            const QByteArray chunk = m_chunk;
+            m_chunk = QByteArray();
+            m_chunkBytesRead = 0;
+            m_readingChunk = false;
+
+            if (m_streaming) {
+                emit chunkReceived(chunk, m_lastChunk);
+            } else if (m_lastChunk) {
+                const QByteArray message = m_message.isEmpty() ? chunk : m_message + chunk;
+                m_message = QByteArray();
+                COPYQ_LOG( QString("Message read (%1 bytes).").arg(message.size()) );
+                emit messageReceived(message);
+            } else {
+                m_message.append(chunk);
+            }
+        }
+    }
+}
@@ -0,0 +1,82 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MESSAGEREADER_H
+#define MESSAGEREADER_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QPointer>
+
+class QIODevice;
+
+/**
+ * Reads messages written with writeMessage() from device without blocking.
+ *
+ * Available data are read whenever device emits readyRead() signal and
+ * messageReceived() is emitted for each complete message. Buffer for chunk of
+ * message is allocated at once after its length is known.
+ *
+ * In streaming mode chunks are passed to receiver with chunkReceived() signal
+ * as they arrive and are never joined to whole message.
+ */
+class MessageReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** Read messages from @a device (reader is deleted with the device). */
+    explicit MessageReader(QIODevice *device);
+
+    QIODevice *device() const { return m_device; }
+
+    /** Emit only chunkReceived() instead of messageReceived(). */
+    void setStreaming(bool streaming) { m_streaming = streaming; }
+
+signals:
+    /** Complete message was read. */
+    void messageReceived(const QByteArray &message);
+
+    /** Chunk of message was read (in streaming mode). */
+    void chunkReceived(const QByteArray &chunk, bool lastChunk);
+
+    /** Data cannot be read from device. */
+    void readError();
+
+public slots:
+    /** Read available data (called automatically when device emits readyRead()). */
+    void readAvailable();
+
+private:
+    QPointer<QIODevice> m_device;
+
+    char m_header[4];
+    int m_headerBytesRead;
+
+    QByteArray m_chunk;
+    int m_chunkBytesRead;
+    bool m_readingChunk;
+    bool m_lastChunk;
+
+    /** Previous chunks of current message (if not streaming). */
+    QByteArray m_message;
+    bool m_streaming;
+};
+
+#endif // MESSAGEREADER_H
@@ -0,0 +1,128 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "messagewriter.h"
+
+#include "common/client_server.h"
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QIODevice>
+
+namespace {
+
+// Don't write next chunk while device has more bytes to write.
+const qint64 maxBufferedBytes = 2 * messageChunkBytes;
+
+} // namespace
+
+MessageWriter::MessageWriter(QIODevice *device)
+    : QObject(device)
+    , m_device(device)
+    , m_messages()
+    , m_pendingBytes(0)
+{
+    connect( device, SIGNAL(bytesWritten(qint64)),
+             this, SLOT(writePending()) );
+}
+
+MessageWriter *MessageWriter::writer(QIODevice *device)
+{
+    MessageWriter *writer = device->findChild<MessageWriter*>();
+    return writer != NULL ? writer : new MessageWriter(device);
+}
+
+void MessageWriter::write(const QList<QByteArray> &parts)
+{
+    Message message;
+    message.parts = parts;
+    message.part = 0;
+    message.offset = 0;
+    message.remaining = 0;
+    foreach (const QByteArray &part, parts)
+        message.remaining += part.size();
+
+    COPYQ_LOG( QString("Write message (%1 bytes).").arg(message.remaining) );
+
+    m_pendingBytes += message.remaining;
+    m_messages.append(message);
+    writePending();
+}
+
+bool MessageWriter::flush(int msecs)
+{
+    QElapsedTimer t;
+    t.start();
+
+    writePending();
+    while ( !m_messages.isEmpty() || m_device->bytesToWrite() > 0 ) {
+        const int remaining = msecs - static_cast<int>( t.elapsed() );
+        if ( remaining <= 0 || !m_device->waitForBytesWritten(remaining) )
+            return false;
+        writePending();
+    }
+
+    return true;
+}
+
+void MessageWriter::writePending()
+{
+    const qint64 pendingBytes = m_pendingBytes;
+
+    while ( !m_messages.isEmpty() && m_device->bytesToWrite() < maxBufferedBytes ) {
+        Message &message = m_messages.first();
+
+        const qint64 chunkSize = qMin<qint64>(message.remaining, messageChunkBytes);
+        const bool last = chunkSize == message.remaining;
+
+        QDataStream out(m_device);
+        // chunk length is serialized as a quint32 (with flag if more chunks follow)
+        out << ( static_cast<quint32>(chunkSize) | (last ? 0 : messageChunkFlag) );
+
+        // Write chunk directly from message parts.
+        qint64 toWrite = chunkSize;
+        while (toWrite > 0) {
+            const QByteArray &part = message.parts[message.part];
+            const int len = qMin<qint64>(toWrite, part.size() - message.offset);
+            out.writeRawData( part.constData() + message.offset, len );
+            toWrite -= len;
+            message.offset += len;
+            if ( message.offset == part.size() ) {
+                ++message.part;
+                message.offset = 0;
+            }
+        }
+
+        message.remaining -= chunkSize;
+        m_pendingBytes -= chunkSize;
+
+        if (out.status() != QDataStream::Ok) {
+            log( "Cannot write message!", LogError );
+            m_pendingBytes -= message.remaining;
+            m_messages.removeFirst();
+        } else if (last) {
+            COPYQ_LOG("Message written.");
+            m_messages.removeFirst();
+        }
+    }
+
+    if (pendingBytes != m_pendingBytes)
+        emit written(pendingBytes - m_pendingBytes);
+}
@@ -0,0 +1,82 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MESSAGEWRITER_H
+#define MESSAGEWRITER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+
+class QIODevice;
+
+/**
+ * Writes messages to device in chunks.
+ *
+ * Each message is split into chunks of at most messageChunkBytes. Next chunk
+ * is written only after device wrote most of the previous data so the write
+ * buffer of device stays small even for huge messages.
+ *
+ * Messages are written in the order in which they were queued.
+ */
+class MessageWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    /** Return writer for @a device (created on first use and deleted with the device). */
+    static MessageWriter *writer(QIODevice *device);
+
+    /** Queue message consisting of @a parts (parts are not copied until written). */
+    void write(const QList<QByteArray> &parts);
+
+    /**
+     * Write all queued messages, block at most @a msecs milliseconds.
+     * @return true only if all messages were written
+     */
+    bool flush(int msecs = 30000);
+
+    /** Return number of queued bytes which were not yet passed to device. */
+    qint64 pendingBytes() const { return m_pendingBytes; }
+
+signals:
+    /** Emitted after @a bytes of queued messages were passed to device (or dropped). */
+    void written(qint64 bytes);
+
+private slots:
+    /** Write chunks until device write buffer is full. */
+    void writePending();
+
+private:
+    explicit MessageWriter(QIODevice *device);
+
+    struct Message {
+        QList<QByteArray> parts;
+        int part;
+        int offset;
+        qint64 remaining;
+    };
+
+    QIODevice *m_device;
+    QList<Message> m_messages;
+    qint64 m_pendingBytes;
+};
+
+#endif // MESSAGEWRITER_H
@@ -0,0 +1,190 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mimedatacodec.h"
+
+#include "common/client_server.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QMimeData>
+#include <QSharedMemory>
+#include <QStringList>
+
+#include <cstring>
+
+namespace {
+
+// Data for single format larger than this are sent through shared memory.
+const int sharedMinBytes = 256 * 1024;
+
+// Format for keys of shared memory segments which the receiver already read.
+const QString mimeSharedMemoryRelease = "application/x-copyq-shared-memory-release";
+
+enum DataKind {
+    DataInline = 0,
+    DataShared = 1
+};
+
+bool readShared(const QString &key, int size, QByteArray *bytes)
+{
+    QSharedMemory memory(key);
+    if ( !memory.attach(QSharedMemory::ReadOnly) ) {
+        log( QObject::tr("Cannot attach shared memory: %1").arg(memory.errorString()), LogError );
+        return false;
+    }
+
+    if ( memory.size() < size ) {
+        log( QObject::tr("Shared memory segment is too small!"), LogError );
+        return false;
+    }
+
+    memory.lock();
+    *bytes = QByteArray( static_cast<const char *>(memory.constData()), size );
+    memory.unlock();
+
+    return true;
+}
+
+} // namespace
+
+MimeDataCodec::MimeDataCodec()
+    : m_segments()
+    , m_counter(0)
+{
+}
+
+MimeDataCodec::~MimeDataCodec()
+{
+}
+
+QByteArray MimeDataCodec::serialize(const QMimeData &data)
+{
+    const QStringList formats = data.formats();
+
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out << static_cast<qint32>( formats.size() );
+
+    foreach (const QString &mime, formats) {
+        const QByteArray formatData = data.data(mime);
+        out << mime;
+
+        const QString key = formatData.size() >= sharedMinBytes ? share(formatData) : QString();
+        if ( key.isEmpty() ) {
+            out << static_cast<quint8>(DataInline) << formatData;
+        } else {
+            out << static_cast<quint8>(DataShared) << key
+                << static_cast<qint32>( formatData.size() );
+        }
+    }
+
+    return bytes;
+}
+
+bool MimeDataCodec::deserialize(const QByteArray &bytes, QMimeData *data,
+                                QStringList *sharedKeys)
+{
+    QDataStream in(bytes);
+
+    qint32 length;
+    in >> length;
+
+    for (qint32 i = 0; i < length && in.status() == QDataStream::Ok; ++i) {
+        QString mime;
+        quint8 kind;
+        in >> mime >> kind;
+
+        QByteArray formatData;
+        if (kind == DataShared) {
+            QString key;
+            qint32 size;
+            in >> key >> size;
+            if ( in.status() != QDataStream::Ok )
+                return false;
+            if (sharedKeys != NULL)
+                sharedKeys->append(key);
+            if ( !readShared(key, size, &formatData) )
+                return false;
+        } else {
+            in >> formatData;
+        }
+
+        data->setData(mime, formatData);
+    }
+
+    return in.status() == QDataStream::Ok;
+}
+
+QByteArray MimeDataCodec::releaseMessage(const QStringList &keys)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out << static_cast<qint32>(1)
+        << mimeSharedMemoryRelease
+        << static_cast<quint8>(DataInline)
+        << keys.join("\n").toUtf8();
+    return bytes;
+}
+
+bool MimeDataCodec::release(const QMimeData &data)
+{
+    if ( !data.hasFormat(mimeSharedMemoryRelease) )
+        return false;
+
+    // Segment is destroyed after both processes detach from it.
+    const QString keys = QString::fromUtf8( data.data(mimeSharedMemoryRelease) );
+    foreach ( const QString &key, keys.split('\n', QString::SkipEmptyParts) )
+        m_segments.remove(key);
+
+    return true;
+}
+
+void MimeDataCodec::releaseAll()
+{
+    m_segments.clear();
+}
+
+int MimeDataCodec::sharedMemoryMinBytes()
+{
+    return sharedMinBytes;
+}
+
+QString MimeDataCodec::share(const QByteArray &bytes)
+{
+    const QString key = QString("%1_shm_%2_%3")
+            .arg( serverName("data") )
+            .arg( QCoreApplication::applicationPid() )
+            .arg( ++m_counter );
+
+    QSharedPointer<QSharedMemory> memory( new QSharedMemory(key) );
+    if ( !memory->create(bytes.size()) ) {
+        COPYQ_LOG( QString("Cannot create shared memory: %1").arg(memory->errorString()) );
+        return QString();
+    }
+
+    memory->lock();
+    memcpy( memory->data(), bytes.constData(), bytes.size() );
+    memory->unlock();
+
+    m_segments.insert(key, memory);
+
+    return key;
+}
@@ -0,0 +1,94 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MIMEDATACODEC_H
+#define MIMEDATACODEC_H
+
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+
+class QByteArray;
+class QMimeData;
+class QSharedMemory;
+class QStringList;
+
+/**
+ * Serializes clipboard data for sending between monitor and server processes.
+ *
+ * Unlike ClipboardItem serialization operators, data are not compressed.
+ *
+ * Data of formats larger than sharedMemoryMinBytes() are copied to shared
+ * memory segments and only key of the segment is sent (receiver copies the
+ * data out of the segment). Codec keeps segments created by serialize() until
+ * the receiver acknowledges them with message from releaseMessage().
+ */
+class MimeDataCodec
+{
+public:
+    MimeDataCodec();
+
+    ~MimeDataCodec();
+
+    /** Return serialized @a data. */
+    QByteArray serialize(const QMimeData &data);
+
+    /**
+     * Deserialize @a bytes (created with serialize()) to @a data.
+     *
+     * Keys of shared memory segments in message are appended to @a sharedKeys
+     * (even if reading fails); send them back to the sender using releaseMessage().
+     *
+     * @return true only if all data were read successfully
+     */
+    static bool deserialize(const QByteArray &bytes, QMimeData *data,
+                            QStringList *sharedKeys = NULL);
+
+    /** Return message for sender of data to release shared memory segments with @a keys. */
+    static QByteArray releaseMessage(const QStringList &keys);
+
+    /**
+     * Release segments if @a data is deserialized message from releaseMessage().
+     * @return true if @a data was such message
+     */
+    bool release(const QMimeData &data);
+
+    /** Release all segments (e.g. if the other process was restarted). */
+    void releaseAll();
+
+    /** Return number of segments waiting for acknowledgement from receiver. */
+    int sharedSegmentCount() const { return m_segments.size(); }
+
+    /** Minimum size of data for single format to pass through shared memory. */
+    static int sharedMemoryMinBytes();
+
+private:
+    /** Create shared memory segment with @a bytes, return its key or empty string on error. */
+    QString share(const QByteArray &bytes);
+
+    /** Segments by key. */
+    QHash< QString, QSharedPointer<QSharedMemory> > m_segments;
+    int m_counter;
+
+    // Disable copying.
+    MimeDataCodec(const MimeDataCodec &);
+    MimeDataCodec &operator=(const MimeDataCodec &);
+};
+
+#endif // MIMEDATACODEC_H
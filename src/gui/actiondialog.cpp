@@ -21,6 +21,7 @@
 #include "ui_actiondialog.h"
 
 #include "common/action.h"
+#include "common/actionscheduler.h"
 #include "common/client_server.h"
 #include "common/command.h"
 #include "gui/configurationmanager.h"
@@ -29,9 +30,13 @@
 #include <QFile>
 #include <QMessageBox>
 #include <QMimeData>
+#include <QTimer>
 
 namespace {
 
+/// Interval for updating wait times of queued actions.
+const int updateQueueStatusIntervalMs = 1000;
+
 const QStringList standardFormats = QStringList() << QString() << QString("text/plain");
 
 bool wasChangedByUser(QObject *object)
@@ -51,9 +56,13 @@ ActionDialog::ActionDialog(QWidget *parent)
     , ui(new Ui::ActionDialog)
     , m_re()
     , m_data(NULL)
+    , m_scheduler(NULL)
 {
     ui->setupUi(this);
 
+    ui->labelQueue->hide();
+    ui->pushButtonCancelQueued->hide();
+
     on_comboBoxInputFormat_currentIndexChanged(QString());
     on_comboBoxOutputFormat_editTextChanged(QString());
     loadSettings();
@@ -132,6 +141,21 @@ void ActionDialog::saveHistory()
         out << QVariant(ui->cmdEdit->itemData(i));
 }
 
+void ActionDialog::setActionScheduler(ActionScheduler *scheduler)
+{
+    m_scheduler = scheduler;
+
+    connect( m_scheduler, SIGNAL(queueChanged()),
+             this, SLOT(updateQueueStatus()) );
+
+    QTimer *timer = new QTimer(this);
+    timer->start(updateQueueStatusIntervalMs);
+    connect( timer, SIGNAL(timeout()),
+             this, SLOT(updateQueueStatus()) );
+
+    updateQueueStatus();
+}
+
 void ActionDialog::createAction()
 {
     QString cmd = ui->cmdEdit->currentText();
@@ -420,3 +444,37 @@ void ActionDialog::on_separatorEdit_textEdited(const QString &)
 {
     setChangedByUser(ui->separatorEdit);
 }
+
+void ActionDialog::on_pushButtonCancelQueued_clicked()
+{
+    if (m_scheduler != NULL)
+        m_scheduler->cancelQueuedActions();
+}
+
+void ActionDialog::updateQueueStatus()
+{
+    const int running = m_scheduler != NULL ? m_scheduler->runningActionCount() : 0;
+    const int queued = m_scheduler != NULL ? m_scheduler->queuedActionCount() : 0;
+
+    if (running == 0 && queued == 0) {
+        ui->labelQueue->hide();
+        ui->pushButtonCancelQueued->hide();
+        return;
+    }
+
+    QString text = tr("Running commands: %1").arg(running);
+    if (queued > 0) {
+        text.append( '\n' + tr("Waiting commands: %1 (automatic: %2), longest wait: %3 s")
+                     .arg(queued)
+                     .arg( m_scheduler->queuedActionCount(ActionScheduler::PriorityAutomatic) )
+                     .arg( m_scheduler->longestWaitMs() / 1000 ) );
+    }
+    if ( m_scheduler->averageWaitMs() > 0 ) {
+        text.append( '\n' + tr("Average wait: %1 s")
+                     .arg(m_scheduler->averageWaitMs() / 1000.0, 0, 'f', 1) );
+    }
+
+    ui->labelQueue->setText(text);
+    ui->labelQueue->show();
+    ui->pushButtonCancelQueued->setVisible(queued > 0);
+}
@@ -25,6 +25,7 @@
 #include <QRegExp>
 
 class Action;
+class ActionScheduler;
 class QAbstractButton;
 class QMimeData;
 struct Command;
@@ -65,6 +66,8 @@ public:
     void setRegExp(const QRegExp &re);
     /** Set output item. */
     void setOutputIndex(const QModelIndex &index);
+    /** Show number of running and queued actions. */
+    void setActionScheduler(ActionScheduler *scheduler);
 
     /** Load settings. */
     void loadSettings();
@@ -81,6 +84,7 @@ private:
     QRegExp m_re;
     QMimeData *m_data;
     QModelIndex m_index;
+    ActionScheduler *m_scheduler;
 
 signals:
     /** Emitted if dialog was accepted. */
@@ -95,7 +99,9 @@ private slots:
     void on_comboBoxOutputFormat_editTextChanged(const QString &text);
     void on_comboBoxOutputTab_editTextChanged(const QString &text);
     void on_separatorEdit_textEdited(const QString &text);
+    void on_pushButtonCancelQueued_clicked();
     void updateMinimalGeometry();
+    void updateQueueStatus();
 
 public slots:
     /** Create action from dialog's content. */
@@ -108,6 +108,7 @@ ClipboardBrowserShared::ClipboardBrowserShared()
     , maxImageHeight(100)
     , textWrap(true)
     , commands()
+    , commandMatcher()
     , viMode(false)
     , saveOnReturnKey(false)
     , moveItemOnReturnKey(false)
@@ -125,6 +126,7 @@ void ClipboardBrowserShared::loadFromConfiguration()
     maxImageHeight = cm->value("max_image_height").toInt();
     textWrap = cm->value("text_wrap").toBool();
     commands = cm->commands();
+    commandMatcher.setCommands(commands);
     viMode = cm->value("vi").toBool();
     saveOnReturnKey = !cm->value("edit_ctrl_return").toBool();
     moveItemOnReturnKey = cm->value("move").toBool();
@@ -155,6 +157,7 @@ ClipboardBrowser::ClipboardBrowser(QWidget *parent, const ClipboardBrowserShared
     , m_timerSave( new QTimer(this) )
     , m_timerScroll( new QTimer(this) )
     , m_timerShowNotes( new QTimer(this) )
+    , m_timerUpdateSizes( new QTimer(this) )
     , m_menu(NULL)
     , m_save(true)
     , m_editing(false)
@@ -183,6 +186,12 @@ ClipboardBrowser::ClipboardBrowser(QWidget *parent, const ClipboardBrowserShared
     connect( m_timerShowNotes, SIGNAL(timeout()),
              this, SLOT(updateItemNotes()) );
 
+    // Resize items at most once per interval while window is being resized.
+    m_timerUpdateSizes->setSingleShot(true);
+    m_timerUpdateSizes->setInterval(50);
+    connect( m_timerUpdateSizes, SIGNAL(timeout()),
+             this, SLOT(updateSizes()) );
+
     // delegate for rendering and editing items
     setItemDelegate(d);
 
@@ -258,6 +267,8 @@ void ClipboardBrowser::contextMenuAction()
     Command cmd = m_sharedData->commands[i];
     if ( cmd.outputTab.isEmpty() )
         cmd.outputTab = m_id;
+    // Command was triggered by user.
+    cmd.automatic = false;
 
     bool isContextMenuAction = m_menu != NULL && act->parent() == m_menu;
     const QModelIndexList selected = selectedIndexes();
@@ -653,6 +664,14 @@ void ClipboardBrowser::onRowSizeChanged(int row)
     }
 }
 
+void ClipboardBrowser::updateSizes()
+{
+    if (m_sharedData->textWrap)
+        d->setItemMaximumSize(viewport()->contentsRect().size());
+
+    updateCurrentPage();
+}
+
 void ClipboardBrowser::updateCurrentPage()
 {
     if ( !m_loaded && !m_id.isEmpty() )
@@ -704,10 +723,8 @@ void ClipboardBrowser::resizeEvent(QResizeEvent *event)
 {
     QListView::resizeEvent(event);
 
-    if (m_sharedData->textWrap)
-        d->setItemMaximumSize(viewport()->contentsRect().size());
-
-    updateCurrentPage();
+    if ( !m_timerUpdateSizes->isActive() )
+        m_timerUpdateSizes->start();
 }
 
 void ClipboardBrowser::showEvent(QShowEvent *event)
@@ -795,6 +812,12 @@ void ClipboardBrowser::addItems(const QStringList &items)
     }
 }
 
+void ClipboardBrowser::appendItems(const QList<QMimeData *> &items)
+{
+    foreach (QMimeData *data, items)
+        add(data, true, -1);
+}
+
 void ClipboardBrowser::showItemContent()
 {
     const QMimeData *data = itemData();
@@ -1103,6 +1126,11 @@ ClipboardItem *ClipboardBrowser::at(int row) const
     return m->at(row);
 }
 
+ClipboardModelSnapshotPtr ClipboardBrowser::itemsSnapshot() const
+{
+    return m->snapshot();
+}
+
 void ClipboardBrowser::editSelected()
 {
     if ( selectedIndexes().size() > 1 ) {
@@ -1198,29 +1226,17 @@ bool ClipboardBrowser::add(QMimeData *data, bool force, int row)
         }
 
         // commands
-        bool noText = !data->hasText();
-        const QString text = data->text();
-        const QString windowTitle = QString::fromUtf8( data->data(mimeWindowTitle).data() );
-        foreach (const Command &c, m_sharedData->commands) {
-            if (c.automatic && (c.remove || !c.cmd.isEmpty() || !c.tab.isEmpty())) {
-                if ( ((noText && c.re.isEmpty()) || (!noText && c.re.indexIn(text) != -1))
-                     && (c.input.isEmpty() || data->hasFormat(c.input))
-                     && (windowTitle.isNull() || c.wndre.indexIn(windowTitle) != -1) )
-                {
-                    if (c.automatic) {
-                        Command cmd = c;
-                        if ( cmd.outputTab.isEmpty() )
-                            cmd.outputTab = m_id;
-                        if ( cmd.input.isEmpty() || data->hasFormat(cmd.input) )
-                            emit requestActionDialog(*data, cmd);
-                    }
-                    if (!c.tab.isEmpty())
-                        emit addToTab(data, c.tab);
-                    if (c.remove) {
-                        delete data;
-                        return false;
-                    }
-                }
+        foreach ( int i, m_sharedData->commandMatcher.match(*data) ) {
+            const Command &c = m_sharedData->commands[i];
+            Command cmd = c;
+            if ( cmd.outputTab.isEmpty() )
+                cmd.outputTab = m_id;
+            emit requestActionDialog(*data, cmd);
+            if (!c.tab.isEmpty())
+                emit addToTab(data, c.tab);
+            if (c.remove) {
+                delete data;
+                return false;
             }
         }
     }
@@ -1361,6 +1377,15 @@ QByteArray ClipboardBrowser::itemData(int i, const QString &mime) const
     return mime == "?" ? data->formats().join("\n").toUtf8() + '\n' : data->data(mime);
 }
 
+void ClipboardBrowser::removeRows(const QList<int> &rows)
+{
+    QList<int> sortedRows = rows;
+    qSort( sortedRows.begin(), sortedRows.end(), qGreater<int>() );
+
+    foreach (int row, sortedRows)
+        removeRow(row);
+}
+
 void ClipboardBrowser::editRow(int row)
 {
     editItem( index(row) );
@@ -1444,6 +1469,7 @@ bool ClipboardBrowser::handleViKey(QKeyEvent *event)
 void ClipboardBrowser::setTextWrap(bool enabled)
 {
     d->setItemMaximumSize( enabled ? viewport()->contentsRect().size() : QSize(2048, 2048) );
+    updateCurrentPage();
 }
 
 const QMimeData *ClipboardBrowser::getSelectedItemData() const
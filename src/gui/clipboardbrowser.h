@@ -21,13 +21,14 @@
 #define CLIPBOARDBROWSER_H
 
 #include "common/command.h"
+#include "common/commandmatcher.h"
+#include "item/clipboardmodel.h"
 
 #include <QListView>
 #include <QPointer>
 #include <QSharedPointer>
 
 class ClipboardItem;
-class ClipboardModel;
 class ItemDelegate;
 class QMimeData;
 class QTimer;
@@ -44,6 +45,8 @@ struct ClipboardBrowserShared {
     int maxImageHeight;
     bool textWrap;
     QList<Command> commands;
+    /** Matches automatic commands in @a commands. */
+    CommandMatcher commandMatcher;
     bool viMode;
     bool saveOnReturnKey;
     bool moveItemOnReturnKey;
@@ -114,6 +117,9 @@ class ClipboardBrowser : public QListView
         /** Return clipboard item at given row. */
         ClipboardItem *at(int row) const;
 
+        /** Return items which can be read from other threads. */
+        ClipboardModelSnapshotPtr itemsSnapshot() const;
+
         /** Returns concatenation of selected items. */
         const QString selectedText() const;
 
@@ -192,6 +198,7 @@ class ClipboardBrowser : public QListView
         QTimer *m_timerSave;
         QTimer *m_timerScroll;
         QTimer *m_timerShowNotes;
+        QTimer *m_timerUpdateSizes;
 
         QPointer<QMenu> m_menu;
 
@@ -267,6 +274,9 @@ class ClipboardBrowser : public QListView
 
         void onRowSizeChanged(int row);
 
+        /** Update maximum item size and relayout visible items. */
+        void updateSizes();
+
         void updateCurrentPage();
 
         /**
@@ -317,6 +327,8 @@ class ClipboardBrowser : public QListView
         bool openEditor(const QModelIndex &index);
         /** Add items. */
         void addItems(const QStringList &items);
+        /** Append items (ignores commands and duplicates). */
+        void appendItems(const QList<QMimeData *> &items);
 
         /** Show content of current item. */
         void showItemContent();
@@ -385,6 +397,9 @@ class ClipboardBrowser : public QListView
          */
         QByteArray itemData(int i, const QString &mime) const;
 
+        /** Remove items in given @a rows. */
+        void removeRows(const QList<int> &rows);
+
         /** Edit item in given @a row. */
         void editRow(int row);
 };
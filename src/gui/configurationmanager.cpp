@@ -539,6 +539,7 @@ void ConfigurationManager::initOptions()
     /* other options */
     bind("tabs", QStringList());
     bind("command_history_size", 100);
+    bind("max_running_commands", 4);
     bind("_last_hash", 0);
 #ifndef NO_GLOBAL_SHORTCUTS
     /* shortcuts -- generate options from UI (button text is key for shortcut option) */
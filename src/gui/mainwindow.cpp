@@ -21,6 +21,7 @@
 #include "ui_mainwindow.h"
 
 #include "common/action.h"
+#include "common/actionscheduler.h"
 #include "common/client_server.h"
 #include "common/command.h"
 #include "common/contenttype.h"
@@ -171,6 +172,7 @@ MainWindow::MainWindow(QWidget *parent)
     , m_actionMonitoringDisabled()
     , m_clearFirstTab(false)
     , m_actions()
+    , m_actionScheduler( new ActionScheduler(this) )
     , m_sharedData(new ClipboardBrowserShared)
     , m_trayItemPaste(true)
     , m_trayPasteWindow()
@@ -934,6 +936,8 @@ void MainWindow::loadSettings()
     ConfigurationManager *cm = ConfigurationManager::instance();
     m_confirmExit = cm->value("confirm_exit").toBool();
 
+    m_actionScheduler->setMaxRunningActions( cm->value("max_running_commands").toInt() );
+
     // update menu items and icons
     createMenu();
 
@@ -1542,6 +1546,7 @@ ActionDialog *MainWindow::createActionDialog()
 {
     ActionDialog *actionDialog = new ActionDialog(this);
     actionDialog->setOutputTabs(ui->tabWidget->tabs(), QString());
+    actionDialog->setActionScheduler(m_actionScheduler);
 
     connect( actionDialog, SIGNAL(accepted(Action*)),
              this, SLOT(action(Action*)) );
@@ -1762,16 +1767,7 @@ bool MainWindow::loadTab(const QString &fileName)
         return false;
     }
 
-    // Find unique tab name.
-    QString baseTabName = tabName;
-    QStringList existingTabs = ui->tabWidget->tabs();
-    int i = 0;
-    while ( existingTabs.contains(tabName) ) {
-        log(tabName);
-        tabName = baseTabName + " (" + QString::number(++i) + ')';
-    }
-
-    ClipboardBrowser *c = createTab(tabName);
+    ClipboardBrowser *c = getBrowser( createUniqueTab(tabName) );
     ClipboardModel *model = static_cast<ClipboardModel *>( c->model() );
 
     in >> *model;
@@ -1781,6 +1777,19 @@ bool MainWindow::loadTab(const QString &fileName)
     return true;
 }
 
+int MainWindow::createUniqueTab(const QString &name)
+{
+    QString tabName = name;
+    QStringList existingTabs = ui->tabWidget->tabs();
+    int i = 0;
+    while ( existingTabs.contains(tabName) ) {
+        log(tabName);
+        tabName = name + " (" + QString::number(++i) + ')';
+    }
+
+    return tabIndex( createTab(tabName) );
+}
+
 bool MainWindow::loadTab()
 {
     QString fileName = QFileDialog::getOpenFileName( this, QString(), QString(),
@@ -1813,6 +1822,16 @@ void MainWindow::reverseSelectedItems()
 }
 
 void MainWindow::action(Action *action)
+{
+    runAction(action, false);
+}
+
+void MainWindow::automaticAction(Action *action)
+{
+    runAction(action, true);
+}
+
+void MainWindow::runAction(Action *action, bool automatic)
 {
     connect( action, SIGNAL(newItems(QStringList, QString)),
              this, SLOT(addItems(QStringList, QString)) );
@@ -1830,7 +1849,8 @@ void MainWindow::action(Action *action)
              this, SLOT(actionError(Action*)) );
 
     log( tr("Executing: %1").arg(action->command()) );
-    action->start();
+    m_actionScheduler->addAction( action, automatic ? ActionScheduler::PriorityAutomatic
+                                                    : ActionScheduler::PriorityInteractive );
 }
 
 void MainWindow::action(const QMimeData &data, const Command &cmd, const QModelIndex &outputIndex)
@@ -1862,6 +1882,12 @@ void MainWindow::action(const QMimeData &data, const Command &cmd, const QModelI
     } else {
         // Create action without showing action dialog.
         actionDialog->setOutputTabs(QStringList(), outputTab);
+        if (cmd.automatic) {
+            disconnect( actionDialog, SIGNAL(accepted(Action*)),
+                        this, SLOT(action(Action*)) );
+            connect( actionDialog, SIGNAL(accepted(Action*)),
+                     this, SLOT(automaticAction(Action*)) );
+        }
         actionDialog->createAction();
         actionDialog->deleteLater();
     }
@@ -31,6 +31,7 @@
 class AboutDialog;
 class Action;
 class ActionDialog;
+class ActionScheduler;
 class ClipboardBrowser;
 class ClipboardItem;
 class QAction;
@@ -201,6 +202,9 @@ class MainWindow : public QMainWindow
         /** Execute action. */
         void action(Action *action);
 
+        /** Execute action of automatic command (after actions started by user). */
+        void automaticAction(Action *action);
+
         /** Execute command on given input data. */
         void action(const QMimeData &data, const Command &cmd,
                     const QModelIndex &outputIndex = QModelIndex());
@@ -254,6 +258,11 @@ class MainWindow : public QMainWindow
          * @return True only if all items were successfully loaded.
          */
         bool loadTab(const QString &fileName);
+        /**
+         * Create new tab with unique name based on @a name.
+         * @return Index of the new tab.
+         */
+        int createUniqueTab(const QString &name);
         /**
          * Load saved items to new tab.
          * Show file dialog and focus the new tab.
@@ -339,6 +348,9 @@ class MainWindow : public QMainWindow
         /** Delete finished action and its menu item. */
         void closeAction(Action *action);
 
+        /** Start action or queue it if too many actions are running. */
+        void runAction(Action *action, bool automatic);
+
         /** Update tray and window icon depending on current state. */
         void updateIcon();
 
@@ -412,6 +424,7 @@ class MainWindow : public QMainWindow
         bool m_clearFirstTab;
 
         QMap<Action*, QAction*> m_actions;
+        ActionScheduler *m_actionScheduler;
 
         QSharedPointer<ClipboardBrowserShared> m_sharedData;
 
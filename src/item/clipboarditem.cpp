@@ -29,9 +29,19 @@
 #include <QStringList>
 #include <QVariant>
 
+QByteArray ClipboardItemSnapshot::data(const QString &mime) const
+{
+    if (mime == "?")
+        return formats.join("\n").toUtf8() + '\n';
+
+    const int i = formats.indexOf(mime);
+    return i != -1 ? values[i] : QByteArray();
+}
+
 ClipboardItem::ClipboardItem()
     : m_data(new QMimeData)
     , m_hash(0)
+    , m_snapshot()
 {
 }
 
@@ -113,6 +123,8 @@ QVariant ClipboardItem::data(int role) const
             return m_data->imageData();
         } else if (role == contentType::notes) {
             return QString::fromUtf8( m_data->data(mimeItemNotes) );
+        } else if (role == contentType::hash) {
+            return m_hash;
         } else if (role >= contentType::firstFormat) {
             return m_data->data( m_data->formats().value(role - contentType::firstFormat) );
         }
@@ -122,27 +134,44 @@ QVariant ClipboardItem::data(int role) const
 }
 
 
+ClipboardItemSnapshotPtr ClipboardItem::snapshot() const
+{
+    if (m_snapshot.isNull()) {
+        ClipboardItemSnapshot *snapshot = new ClipboardItemSnapshot;
+        snapshot->formats = m_data->formats();
+        foreach (const QString &mime, snapshot->formats)
+            snapshot->values.append( m_data->data(mime) );
+        m_snapshot = ClipboardItemSnapshotPtr(snapshot);
+    }
+
+    return m_snapshot;
+}
+
 void ClipboardItem::updateDataHash()
 {
     m_hash = hash(*m_data, m_data->formats());
+    m_snapshot.clear();
 }
 
-QDataStream &operator<<(QDataStream &stream, const ClipboardItem &item)
+QDataStream &operator<<(QDataStream &stream, const ClipboardItemSnapshot &item)
 {
-    const QMimeData *data = item.data();
-    const QStringList formats = item.data()->formats();
     QByteArray bytes;
-    stream << formats.length();
-    foreach (const QString &mime, formats) {
-        bytes = data->data(mime);
+    stream << item.formats.length();
+    for (int i = 0; i < item.formats.size(); ++i) {
+        bytes = item.values[i];
         if ( !bytes.isEmpty() )
             bytes = qCompress(bytes);
-        stream << mime << bytes;
+        stream << item.formats[i] << bytes;
     }
 
     return stream;
 }
 
+QDataStream &operator<<(QDataStream &stream, const ClipboardItem &item)
+{
+    return stream << *item.snapshot();
+}
+
 QDataStream &operator>>(QDataStream &stream, ClipboardItem &item)
 {
     int length;
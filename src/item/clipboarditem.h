@@ -20,12 +20,35 @@
 #ifndef CLIPBOARDITEM_H
 #define CLIPBOARDITEM_H
 
-class QByteArray;
+#include <QByteArray>
+#include <QList>
+#include <QSharedPointer>
+#include <QStringList>
+
 class QDataStream;
 class QMimeData;
 class QString;
 class QVariant;
 
+/**
+ * Immutable copy of item data which can be read from any thread.
+ *
+ * Data are implicitly shared with the item so creating snapshot is cheap.
+ */
+struct ClipboardItemSnapshot {
+    QStringList formats;
+    /** Data for each format in @a formats. */
+    QList<QByteArray> values;
+
+    /**
+     * Return data for given MIME type.
+     * If MIME type is "?" return list of available MIME types.
+     */
+    QByteArray data(const QString &mime) const;
+};
+
+typedef QSharedPointer<const ClipboardItemSnapshot> ClipboardItemSnapshotPtr;
+
 /**
  * Class for clipboard items in ClipboardModel.
  *
@@ -81,6 +104,9 @@ public:
     /** Return true if data are empty. */
     bool isEmpty() const;
 
+    /** Return snapshot of current data (created only if data changed). */
+    ClipboardItemSnapshotPtr snapshot() const;
+
 private:
     /** Disable copying. */
     ClipboardItem(const ClipboardItem &);
@@ -90,6 +116,7 @@ private:
 
     QMimeData *m_data;
     unsigned int m_hash;
+    mutable ClipboardItemSnapshotPtr m_snapshot;
 };
 
 /**
@@ -97,6 +124,7 @@ private:
  * @{
  */
 QDataStream &operator<<(QDataStream &stream, const ClipboardItem &item);
+QDataStream &operator<<(QDataStream &stream, const ClipboardItemSnapshot &item);
 QDataStream &operator>>(QDataStream &stream, ClipboardItem &item);
 ///@}
 
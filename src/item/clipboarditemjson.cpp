@@ -0,0 +1,563 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "clipboarditemjson.h"
+
+#include "common/client_server.h"
+#include "item/clipboarditem.h"
+
+#include <QIODevice>
+#include <QMimeData>
+#include <QScopedPointer>
+
+#include <cstring>
+
+namespace {
+
+const int formatVersion = 1;
+
+/** Size of blocks read from device. */
+const int readBlockBytes = 64 * 1024;
+
+bool isValidUtf8(const QByteArray &bytes)
+{
+    const uchar *p = reinterpret_cast<const uchar *>( bytes.constData() );
+    const uchar *end = p + bytes.size();
+
+    while (p < end) {
+        const uchar c = *p;
+        if (c < 0x80) {
+            ++p;
+            continue;
+        }
+
+        int n;
+        uint code;
+        uint minCode;
+        if ( (c & 0xe0) == 0xc0 ) {
+            n = 1;
+            code = c & 0x1f;
+            minCode = 0x80;
+        } else if ( (c & 0xf0) == 0xe0 ) {
+            n = 2;
+            code = c & 0x0f;
+            minCode = 0x800;
+        } else if ( (c & 0xf8) == 0xf0 ) {
+            n = 3;
+            code = c & 0x07;
+            minCode = 0x10000;
+        } else {
+            return false;
+        }
+
+        if (end - p <= n)
+            return false;
+
+        for (int i = 1; i <= n; ++i) {
+            if ( (p[i] & 0xc0) != 0x80 )
+                return false;
+            code = (code << 6) | (p[i] & 0x3f);
+        }
+
+        // Reject overlong sequences and surrogates (other JSON parsers would fail).
+        if ( code < minCode || code > 0x10ffff || (code >= 0xd800 && code <= 0xdfff) )
+            return false;
+
+        p += n + 1;
+    }
+
+    return true;
+}
+
+void appendUtf8(uint code, QByteArray *out)
+{
+    if (code < 0x80) {
+        out->append( static_cast<char>(code) );
+    } else if (code < 0x800) {
+        out->append( static_cast<char>(0xc0 | (code >> 6)) );
+        out->append( static_cast<char>(0x80 | (code & 0x3f)) );
+    } else if (code < 0x10000) {
+        out->append( static_cast<char>(0xe0 | (code >> 12)) );
+        out->append( static_cast<char>(0x80 | ((code >> 6) & 0x3f)) );
+        out->append( static_cast<char>(0x80 | (code & 0x3f)) );
+    } else {
+        out->append( static_cast<char>(0xf0 | (code >> 18)) );
+        out->append( static_cast<char>(0x80 | ((code >> 12) & 0x3f)) );
+        out->append( static_cast<char>(0x80 | ((code >> 6) & 0x3f)) );
+        out->append( static_cast<char>(0x80 | (code & 0x3f)) );
+    }
+}
+
+/** Append @a utf8 as JSON string (only quotes, backslashes and control characters are escaped). */
+void appendJsonString(const QByteArray &utf8, QByteArray *out)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out->append('"');
+
+    const char *p = utf8.constData();
+    const char *end = p + utf8.size();
+    const char *run = p;
+    for ( ; p < end; ++p ) {
+        const uchar c = *p;
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        out->append(run, p - run);
+        run = p + 1;
+
+        switch (c) {
+        case '"':  out->append("\\\""); break;
+        case '\\': out->append("\\\\"); break;
+        case '\n': out->append("\\n"); break;
+        case '\r': out->append("\\r"); break;
+        case '\t': out->append("\\t"); break;
+        default: {
+            const char escaped[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+            out->append(escaped, sizeof(escaped));
+        }
+        }
+    }
+    out->append(run, end - run);
+
+    out->append('"');
+}
+
+/**
+ * Simple JSON parser for items.
+ *
+ * Values are read in order they appear in input. After an error all methods
+ * return false.
+ */
+class JsonParser
+{
+public:
+    explicit JsonParser(const QByteArray &bytes)
+        : m_p(bytes.constData())
+        , m_end(m_p + bytes.size())
+        , m_ok(true)
+    {
+    }
+
+    bool ok() const { return m_ok; }
+
+    /** Return true if only whitespace remains. */
+    bool atEnd()
+    {
+        skipSpace();
+        return m_p == m_end;
+    }
+
+    /** Skip character @a c if it's next. */
+    bool accept(char c)
+    {
+        skipSpace();
+        if (m_p == m_end || *m_p != c)
+            return false;
+        ++m_p;
+        return true;
+    }
+
+    /** Skip character @a c, fail if it's not next. */
+    bool expect(char c)
+    {
+        return (m_ok && accept(c)) || fail();
+    }
+
+    /**
+     * Read key of next member of object (after '{' was read).
+     * @return false at the end of object or on error
+     */
+    bool nextMember(bool *first, QByteArray *key)
+    {
+        if ( !m_ok || accept('}') )
+            return false;
+        if ( !*first && !expect(',') )
+            return false;
+        *first = false;
+        return readString(key) && expect(':');
+    }
+
+    bool readString(QByteArray *out)
+    {
+        out->clear();
+        if ( !expect('"') )
+            return false;
+
+        const char *run = m_p;
+        while (m_p < m_end) {
+            const char c = *m_p;
+            if (c == '"') {
+                out->append(run, m_p - run);
+                ++m_p;
+                return true;
+            }
+
+            if (c != '\\') {
+                ++m_p;
+                continue;
+            }
+
+            out->append(run, m_p - run);
+            if (++m_p == m_end)
+                break;
+
+            switch (*m_p++) {
+            case '"':  out->append('"'); break;
+            case '\\': out->append('\\'); break;
+            case '/':  out->append('/'); break;
+            case 'b':  out->append('\b'); break;
+            case 'f':  out->append('\f'); break;
+            case 'n':  out->append('\n'); break;
+            case 'r':  out->append('\r'); break;
+            case 't':  out->append('\t'); break;
+            case 'u': {
+                uint code;
+                if ( !readHex4(&code) || (code >= 0xdc00 && code <= 0xdfff) )
+                    return fail();
+                if (code >= 0xd800 && code <= 0xdbff) {
+                    uint low;
+                    if ( m_end - m_p < 2 || m_p[0] != '\\' || m_p[1] != 'u' )
+                        return fail();
+                    m_p += 2;
+                    if ( !readHex4(&low) || low < 0xdc00 || low > 0xdfff )
+                        return fail();
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                appendUtf8(code, out);
+                break;
+            }
+            default:
+                return fail();
+            }
+
+            run = m_p;
+        }
+
+        return fail();
+    }
+
+    bool readInt(int *number)
+    {
+        skipSpace();
+
+        const bool negative = m_p < m_end && *m_p == '-';
+        if (negative)
+            ++m_p;
+
+        if (m_p == m_end || *m_p < '0' || *m_p > '9')
+            return fail();
+
+        *number = 0;
+        while (m_p < m_end && *m_p >= '0' && *m_p <= '9')
+            *number = *number * 10 + (*m_p++ - '0');
+        if (negative)
+            *number = -*number;
+
+        return true;
+    }
+
+    /** Skip any value. */
+    bool skipValue()
+    {
+        skipSpace();
+        if (!m_ok || m_p == m_end)
+            return fail();
+
+        const char c = *m_p;
+        if (c == '"') {
+            QByteArray value;
+            return readString(&value);
+        }
+
+        if (c == '{') {
+            ++m_p;
+            bool first = true;
+            QByteArray key;
+            while ( nextMember(&first, &key) )
+                skipValue();
+            return m_ok;
+        }
+
+        if (c == '[') {
+            ++m_p;
+            if ( accept(']') )
+                return true;
+            do {
+                skipValue();
+            } while ( m_ok && accept(',') );
+            return expect(']');
+        }
+
+        if ( skipLiteral("true") || skipLiteral("false") || skipLiteral("null") )
+            return true;
+
+        // Number.
+        const char *start = m_p;
+        while ( m_p < m_end && *m_p != '\0' && strchr("+-0123456789.eE", *m_p) != NULL )
+            ++m_p;
+        return m_p != start || fail();
+    }
+
+private:
+    void skipSpace()
+    {
+        while ( m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\r' || *m_p == '\n') )
+            ++m_p;
+    }
+
+    bool skipLiteral(const char *literal)
+    {
+        const int size = static_cast<int>( strlen(literal) );
+        if ( m_end - m_p < size || strncmp(m_p, literal, size) != 0 )
+            return false;
+        m_p += size;
+        return true;
+    }
+
+    bool readHex4(uint *code)
+    {
+        if (m_end - m_p < 4)
+            return false;
+
+        *code = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char c = *m_p++;
+            uint digit;
+            if (c >= '0' && c <= '9')
+                digit = c - '0';
+            else if (c >= 'a' && c <= 'f')
+                digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                digit = c - 'A' + 10;
+            else
+                return false;
+            *code = (*code << 4) | digit;
+        }
+
+        return true;
+    }
+
+    bool fail()
+    {
+        m_ok = false;
+        return false;
+    }
+
+    const char *m_p;
+    const char *m_end;
+    bool m_ok;
+};
+
+} // namespace
+
+void serializeTabHeaderJson(const QString &tabName, QByteArray *out)
+{
+    out->append("{\"copyq\":");
+    out->append( QByteArray::number(formatVersion) );
+    out->append(",\"tab\":");
+    appendJsonString( tabName.toUtf8(), out );
+    out->append("}\n");
+}
+
+void serializeItemJson(const ClipboardItemSnapshot &item, QByteArray *out)
+{
+    const QByteArray *notes = NULL;
+    const QByteArray *windowTitle = NULL;
+    bool first = true;
+
+    out->append("{\"formats\":{");
+
+    for (int i = 0; i < item.formats.size(); ++i) {
+        const QString &format = item.formats[i];
+        const QByteArray &value = item.values[i];
+        const bool isText = isValidUtf8(value);
+
+        if (isText && format == mimeItemNotes) {
+            notes = &value;
+            continue;
+        }
+
+        if (isText && format == mimeWindowTitle) {
+            windowTitle = &value;
+            continue;
+        }
+
+        if (!first)
+            out->append(',');
+        first = false;
+
+        appendJsonString( format.toUtf8(), out );
+        if (isText) {
+            out->append(":{\"text\":");
+            appendJsonString(value, out);
+        } else {
+            out->append(":{\"base64\":\"");
+            out->append( value.toBase64() );
+            out->append('"');
+        }
+        out->append('}');
+    }
+
+    out->append('}');
+
+    if (notes != NULL) {
+        out->append(",\"notes\":");
+        appendJsonString(*notes, out);
+    }
+
+    if (windowTitle != NULL) {
+        out->append(",\"windowTitle\":");
+        appendJsonString(*windowTitle, out);
+    }
+
+    out->append("}\n");
+}
+
+ClipboardItemJsonReader::ClipboardItemJsonReader(QIODevice *device)
+    : m_device(device)
+    , m_buffer()
+    , m_bufferPos(0)
+    , m_line()
+    , m_lineNumber(0)
+    , m_atEnd(false)
+    , m_error(false)
+{
+}
+
+bool ClipboardItemJsonReader::readHeader(QString *tabName)
+{
+    if ( m_error || !readLine() ) {
+        m_error = true;
+        return false;
+    }
+
+    JsonParser json(m_line);
+    QByteArray key;
+    QByteArray value;
+    bool first = true;
+    int version = -1;
+
+    if ( json.expect('{') ) {
+        while ( json.nextMember(&first, &key) ) {
+            if (key == "copyq") {
+                json.readInt(&version);
+            } else if (key == "tab") {
+                if ( json.readString(&value) )
+                    *tabName = QString::fromUtf8( value.constData(), value.size() );
+            } else {
+                json.skipValue();
+            }
+        }
+    }
+
+    m_error = !json.ok() || !json.atEnd() || version != formatVersion || tabName->isEmpty();
+    return !m_error;
+}
+
+QMimeData *ClipboardItemJsonReader::readItem()
+{
+    if ( m_error || !readLine() )
+        return NULL;
+
+    JsonParser json(m_line);
+    QScopedPointer<QMimeData> data(new QMimeData);
+    QByteArray key;
+    QByteArray value;
+    bool first = true;
+
+    if ( json.expect('{') ) {
+        while ( json.nextMember(&first, &key) ) {
+            if (key == "formats") {
+                QByteArray format;
+                bool firstFormat = true;
+                if ( !json.expect('{') )
+                    break;
+                while ( json.nextMember(&firstFormat, &format) ) {
+                    const QString mime = QString::fromUtf8( format.constData(), format.size() );
+                    QByteArray encoding;
+                    bool firstEncoding = true;
+                    if ( !json.expect('{') )
+                        break;
+                    while ( json.nextMember(&firstEncoding, &encoding) ) {
+                        if (encoding == "text") {
+                            if ( json.readString(&value) )
+                                data->setData(mime, value);
+                        } else if (encoding == "base64") {
+                            if ( json.readString(&value) )
+                                data->setData( mime, QByteArray::fromBase64(value) );
+                        } else {
+                            json.skipValue();
+                        }
+                    }
+                }
+            } else if (key == "notes") {
+                if ( json.readString(&value) )
+                    data->setData(mimeItemNotes, value);
+            } else if (key == "windowTitle") {
+                if ( json.readString(&value) )
+                    data->setData(mimeWindowTitle, value);
+            } else {
+                json.skipValue();
+            }
+        }
+    }
+
+    if ( !json.ok() || !json.atEnd() ) {
+        m_error = true;
+        return NULL;
+    }
+
+    return data.take();
+}
+
+bool ClipboardItemJsonReader::readLine()
+{
+    int from = m_bufferPos;
+
+    forever {
+        const int i = m_buffer.indexOf('\n', from);
+        if (i != -1) {
+            m_line = m_buffer.mid(m_bufferPos, i - m_bufferPos);
+            m_bufferPos = i + 1;
+        } else if (m_atEnd) {
+            if ( m_bufferPos >= m_buffer.size() )
+                return false;
+            m_line = m_buffer.mid(m_bufferPos);
+            m_bufferPos = m_buffer.size();
+        } else {
+            // Drop lines already read and append next block (don't search same data again).
+            m_buffer.remove(0, m_bufferPos);
+            m_bufferPos = 0;
+            const int size = m_buffer.size();
+            from = size;
+            m_buffer.resize(size + readBlockBytes);
+            const qint64 bytesRead = m_device->read(m_buffer.data() + size, readBlockBytes);
+            m_buffer.resize( size + static_cast<int>(qMax<qint64>(0, bytesRead)) );
+            if (bytesRead <= 0)
+                m_atEnd = true;
+            continue;
+        }
+
+        ++m_lineNumber;
+        if ( !JsonParser(m_line).atEnd() )
+            return true;
+        from = m_bufferPos;
+    }
+}
@@ -0,0 +1,97 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CLIPBOARDITEMJSON_H
+#define CLIPBOARDITEMJSON_H
+
+#include <QByteArray>
+#include <QString>
+
+class QIODevice;
+class QMimeData;
+struct ClipboardItemSnapshot;
+
+/**
+ * @defgroup clipboard_item_json Items in JSON Format
+ *
+ * Tab is serialized as NDJSON (one JSON object per line). First line is header
+ * with tab name followed by a line for each item.
+ *
+ * @code
+ * {"copyq":1,"tab":"clipboard"}
+ * {"formats":{"text/plain":{"text":"Hello"},"image/png":{"base64":"iVBORw0K..."}},"notes":"..."}
+ * @endcode
+ *
+ * Data which are valid UTF-8 are stored as "text", other data as "base64".
+ * Item notes and window title are stored in "notes" and "windowTitle".
+ * @{
+ */
+
+/** Append header line for tab with @a tabName to @a out. */
+void serializeTabHeaderJson(const QString &tabName, QByteArray *out);
+
+/** Append line with @a item to @a out. */
+void serializeItemJson(const ClipboardItemSnapshot &item, QByteArray *out);
+
+/**
+ * Reads items in JSON format from device.
+ *
+ * Device is read in large blocks so reading from slow devices is efficient;
+ * only current line is kept in memory.
+ */
+class ClipboardItemJsonReader
+{
+public:
+    explicit ClipboardItemJsonReader(QIODevice *device);
+
+    /** Read header, return false on error. */
+    bool readHeader(QString *tabName);
+
+    /**
+     * Read next item.
+     * @return new item data or NULL at the end of input or on error
+     */
+    QMimeData *readItem();
+
+    /** Return true if input is not valid. */
+    bool hasError() const { return m_error; }
+
+    /** Return number of current line (for error messages). */
+    int lineNumber() const { return m_lineNumber; }
+
+private:
+    /** Read next non-empty line to m_line, return false at the end of input. */
+    bool readLine();
+
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    int m_bufferPos;
+    QByteArray m_line;
+    int m_lineNumber;
+    bool m_atEnd;
+    bool m_error;
+
+    // Disable copying.
+    ClipboardItemJsonReader(const ClipboardItemJsonReader &);
+    ClipboardItemJsonReader &operator=(const ClipboardItemJsonReader &);
+};
+
+/** @} */
+
+#endif // CLIPBOARDITEMJSON_H
@@ -24,6 +24,8 @@
 #include "clipboarditem.h"
 
 #include <QDataStream>
+#include <QMutexLocker>
+#include <QThread>
 
 const QModelIndex emptyIndex;
 
@@ -31,7 +33,23 @@ ClipboardModel::ClipboardModel(QObject *parent)
     : QAbstractListModel(parent)
     , m_clipboardList()
     , m_max(100)
+    , m_snapshotMutex()
+    , m_snapshot()
+    , m_snapshotOutdated(true)
 {
+
+    connect( this, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+             SLOT(updateSnapshot()) );
+    connect( this, SIGNAL(rowsInserted(QModelIndex,int,int)),
+             SLOT(updateSnapshot()) );
+    connect( this, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+             SLOT(updateSnapshot()) );
+    connect( this, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+             SLOT(updateSnapshot()) );
+    connect( this, SIGNAL(layoutChanged()),
+             SLOT(updateSnapshot()) );
+    connect( this, SIGNAL(modelReset()),
+             SLOT(updateSnapshot()) );
 }
 
 ClipboardModel::~ClipboardModel()
@@ -268,6 +286,54 @@ void ClipboardModel::sortItems(const QModelIndexList &indexList,
     }
 }
 
+ClipboardModelSnapshotPtr ClipboardModel::snapshot() const
+{
+    {
+        QMutexLocker lock(&m_snapshotMutex);
+        if (!m_snapshotOutdated)
+            return m_snapshot;
+    }
+
+    // Items can be accessed only from model's thread.
+    ClipboardModel *model = const_cast<ClipboardModel *>(this);
+    if ( QThread::currentThread() == thread() )
+        model->createSnapshot();
+    else
+        QMetaObject::invokeMethod(model, "createSnapshot", Qt::BlockingQueuedConnection);
+
+    QMutexLocker lock(&m_snapshotMutex);
+    return m_snapshot;
+}
+
+void ClipboardModel::updateSnapshot()
+{
+    QMutexLocker lock(&m_snapshotMutex);
+    m_snapshotOutdated = true;
+}
+
+void ClipboardModel::createSnapshot()
+{
+    {
+        QMutexLocker lock(&m_snapshotMutex);
+        if (!m_snapshotOutdated)
+            return;
+    }
+
+    ClipboardModelSnapshot *snapshot = new ClipboardModelSnapshot;
+    foreach (const ClipboardItem *item, m_clipboardList)
+        snapshot->items.append( item->snapshot() );
+
+    ClipboardModelSnapshotPtr oldSnapshot;
+    {
+        QMutexLocker lock(&m_snapshotMutex);
+        snapshot->version = m_snapshot.isNull() ? 0 : m_snapshot->version + 1;
+        oldSnapshot = m_snapshot;
+        m_snapshot = ClipboardModelSnapshotPtr(snapshot);
+        m_snapshotOutdated = false;
+    }
+    // Old snapshot is released (possibly freeing data) outside the lock.
+}
+
 int ClipboardModel::findItem(uint item_hash) const
 {
     for (int i = 0; i < m_clipboardList.length(); ++i) {
@@ -308,6 +374,8 @@ QDataStream &operator>>(QDataStream &stream, ClipboardModel &model)
         stream >> *item;
     }
 
+    model.updateSnapshot();
+
     COPYQ_LOG("Items loaded.");
 
     return stream;
@@ -20,12 +20,24 @@
 #ifndef CLIPBOARDMODEL_H
 #define CLIPBOARDMODEL_H
 
+#include "clipboarditem.h"
+
 #include <QAbstractListModel>
 #include <QList>
+#include <QMutex>
 
 class QMimeData;
 
-class ClipboardItem;
+/**
+ * Immutable list of items in model which can be read from any thread.
+ */
+struct ClipboardModelSnapshot {
+    /** Incremented each time snapshot is created after model changed. */
+    quint64 version;
+    QList<ClipboardItemSnapshotPtr> items;
+};
+
+typedef QSharedPointer<const ClipboardModelSnapshot> ClipboardModelSnapshotPtr;
 
 /**
  * Model containing ClipboardItem objects.
@@ -140,9 +152,35 @@ public:
         return (row < rowCount()) ? m_clipboardList[row] : NULL;
     }
 
+    /**
+     * Return current items.
+     *
+     * This method is thread-safe. Snapshot is created only when requested
+     * after model changed; if it's requested from other thread, it waits for
+     * the model's thread to create it, otherwise it doesn't wait.
+     */
+    ClipboardModelSnapshotPtr snapshot() const;
+
+public slots:
+    /**
+     * Mark items changed so snapshot() creates new snapshot.
+     *
+     * Called automatically when model changes; call it explicitly only after
+     * changing items returned by append() or at().
+     */
+    void updateSnapshot();
+
+private slots:
+    /** Create snapshot of current items if model changed (called in model's thread). */
+    void createSnapshot();
+
 private:
     QList<ClipboardItem *> m_clipboardList;
     int m_max;
+
+    mutable QMutex m_snapshotMutex;
+    ClipboardModelSnapshotPtr m_snapshot;
+    bool m_snapshotOutdated;
 };
 
 /**
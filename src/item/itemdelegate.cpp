@@ -81,8 +81,18 @@ QSize ItemDelegate::sizeHint(const QModelIndex &index) const
     int row = index.row();
     if ( row < m_cache.size() ) {
         const ItemWidget *w = m_cache[row].data();
-        if (w != NULL)
-            return w->widget()->size();
+        if (w != NULL) {
+            QSize size = w->widget()->size();
+
+            // Estimate height of item before it's resized (assume that it contains wrapped text).
+            if ( isStale(w) && m_maxSize.width() > 0 ) {
+                const int oldWidth = w->widget()->maximumWidth();
+                size = QSize( m_maxSize.width(),
+                              qMax(1, size.height() * oldWidth / m_maxSize.width()) );
+            }
+
+            return size;
+        }
     }
     return defaultSize;
 }
@@ -316,6 +326,8 @@ ItemWidget *ItemDelegate::cache(const QModelIndex &index)
         setIndexWidget(index, w);
     } else {
         w->widget()->setProperty(propertyItemIndex, index.row());
+        if ( isStale(w) )
+            updateItemSize(w);
     }
 
     return w;
@@ -332,19 +344,9 @@ void ItemDelegate::setItemMaximumSize(const QSize &size)
     if (m_showNumber)
         width -= m_numberWidth;
 
-    if (m_maxSize.width() == width)
-        return;
-
+    // Relayout of all cached items can be very expensive so only the new size
+    // is stored here and items are updated in cache() as needed.
     m_maxSize.setWidth(width);
-
-    for( int i = 0; i < m_cache.length(); ++i ) {
-        ItemWidget *w = m_cache[i].data();
-        if (w != NULL) {
-            w->widget()->setMaximumSize(m_maxSize);
-            w->widget()->setMinimumWidth(width);
-            w->updateSize();
-        }
-    }
 }
 
 void ItemDelegate::updateRowPosition(int row, const QPoint &position)
@@ -410,15 +412,25 @@ void ItemDelegate::setIndexWidget(const QModelIndex &index, ItemWidget *w)
     if (w == NULL)
         return;
 
-    w->widget()->setMaximumSize(m_maxSize);
-    w->widget()->setMinimumWidth(m_maxSize.width());
-    w->updateSize();
+    updateItemSize(w);
     w->widget()->installEventFilter(this);
     w->widget()->setProperty(propertyItemIndex, index.row());
 
     emit rowSizeChanged(index.row());
 }
 
+bool ItemDelegate::isStale(const ItemWidget *w) const
+{
+    return w->widget()->maximumWidth() != m_maxSize.width();
+}
+
+void ItemDelegate::updateItemSize(ItemWidget *w)
+{
+    w->widget()->setMaximumSize(m_maxSize);
+    w->widget()->setMinimumWidth(m_maxSize.width());
+    w->updateSize();
+}
+
 void ItemDelegate::invalidateCache()
 {
     for( int i = 0; i < m_cache.length(); ++i )
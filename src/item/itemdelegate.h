@@ -91,7 +91,12 @@ class ItemDelegate : public QItemDelegate
         /** Return true only if item at index is already in cache. */
         bool hasCache(const QModelIndex &index) const;
 
-        /** Set maximum size for all items. */
+        /**
+         * Set maximum size for all items.
+         *
+         * Cached items are resized lazily in cache() (i.e. when they are about
+         * to be shown), sizeHint() returns estimated size in the meantime.
+         */
         void setItemMaximumSize(const QSize &size);
 
         /** Save edited item on return or ctrl+return. */
@@ -143,6 +148,12 @@ class ItemDelegate : public QItemDelegate
 
         void setIndexWidget(const QModelIndex &index, ItemWidget *w);
 
+        /** Return true if item wasn't resized after maximum size changed. */
+        bool isStale(const ItemWidget *w) const;
+
+        /** Apply current maximum size to item. */
+        void updateItemSize(ItemWidget *w);
+
     public slots:
         // change size buffer
         void dataChanged(const QModelIndex &a, const QModelIndex &b);
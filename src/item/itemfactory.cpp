@@ -35,6 +35,9 @@ namespace {
 
 const int dummyItemMaxChars = 4096;
 
+// Maximum number of items for which the used loader is remembered.
+const int loaderForItemMaxSize = 10000;
+
 bool priorityLessThan(const ItemLoaderInterface *lhs, const ItemLoaderInterface *rhs)
 {
     return lhs->priority() > rhs->priority();
@@ -82,6 +85,7 @@ ItemFactory *ItemFactory::instance()
 ItemFactory::ItemFactory()
     : m_loaders()
     , m_loaderChildren()
+    , m_loaderForItem()
 {
     QDir pluginsDir( QCoreApplication::instance()->applicationDirPath() );
 #if defined(COPYQ_WS_X11)
@@ -146,12 +150,33 @@ ItemWidget *ItemFactory::createItem(ItemLoaderInterface *loader,
 
 ItemWidget *ItemFactory::createItem(const QModelIndex &index, QWidget *parent)
 {
+    const QStringList formats = index.data(contentType::formats).toStringList();
+    // Item hash covers formats too.
+    const uint key = index.data(contentType::hash).toUInt();
+
+    // Try the loader which succeeded last time first (unless it was disabled).
+    ItemLoaderInterface *lastLoader = m_loaderForItem.value(key, NULL);
+    if ( lastLoader != NULL && canLoad(lastLoader, formats) ) {
+        ItemWidget *item = createItem(lastLoader, index, parent);
+        if (item != NULL)
+            return item;
+    }
+
     foreach (ItemLoaderInterface *loader, m_loaders) {
+        if ( loader == lastLoader || !canLoad(loader, formats) )
+            continue;
+
         ItemWidget *item = createItem(loader, index, parent);
-        if (item != NULL)
+        if (item != NULL) {
+            if ( m_loaderForItem.size() >= loaderForItemMaxSize )
+                m_loaderForItem.clear();
+            m_loaderForItem[key] = loader;
             return item;
+        }
     }
 
+    m_loaderForItem.remove(key);
+
     return new DummyItem(index, parent);
 }
 
@@ -183,6 +208,8 @@ QStringList ItemFactory::formatsToSave() const
 
 void ItemFactory::setPluginPriority(const QStringList &pluginNames)
 {
+    m_loaderForItem.clear();
+
     int a = -1;
     int b = -1;
     int j = -1;
@@ -220,6 +247,8 @@ ItemWidget *ItemFactory::otherItemLoader(const QModelIndex &index, ItemWidget *c
     const int currentIndex = m_loaders.indexOf(currentLoader);
     Q_ASSERT(currentIndex != -1);
 
+    const QStringList formats = index.data(contentType::formats).toStringList();
+
     const int size = m_loaders.size();
     for (int i = currentIndex + dir; i != currentIndex; i = i + dir) {
         if (i >= size)
@@ -227,6 +256,12 @@ ItemWidget *ItemFactory::otherItemLoader(const QModelIndex &index, ItemWidget *c
         else if (i < 0)
             i = size - 1;
 
+        if (i == currentIndex)
+            break;
+
+        if ( !canLoad(m_loaders[i], formats) )
+            continue;
+
         ItemWidget *item = createItem(m_loaders[i], index, w->parentWidget());
         if (item != NULL)
             return item;
@@ -234,3 +269,20 @@ ItemWidget *ItemFactory::otherItemLoader(const QModelIndex &index, ItemWidget *c
 
     return NULL;
 }
+
+bool ItemFactory::canLoad(const ItemLoaderInterface *loader, const QStringList &formats) const
+{
+    if ( !loader->isEnabled() )
+        return false;
+
+    const QStringList formatsToLoad = loader->formatsToLoad();
+    if ( formatsToLoad.isEmpty() )
+        return true;
+
+    foreach (const QString &format, formatsToLoad) {
+        if ( formats.contains(format) )
+            return true;
+    }
+
+    return false;
+}
@@ -20,6 +20,7 @@
 #ifndef ITEMFACTORY_H
 #define ITEMFACTORY_H
 
+#include <QHash>
 #include <QObject>
 #include <QVector>
 #include <QMap>
@@ -54,6 +55,11 @@ public:
 
     const QVector<ItemLoaderInterface *> &loaders() const { return m_loaders; }
 
+    /**
+     * Set priority of plugins.
+     *
+     * Also forgets loaders used for items so changes in plugin settings take effect.
+     */
     void setPluginPriority(const QStringList &pluginNames);
 
 private slots:
@@ -62,9 +68,15 @@ private slots:
 private:
     ItemWidget *otherItemLoader(const QModelIndex &index, ItemWidget *current, int dir);
 
+    /** Return true if @a loader is enabled and can display some of the @a formats. */
+    bool canLoad(const ItemLoaderInterface *loader, const QStringList &formats) const;
+
     static ItemFactory *m_Instance;
     QVector<ItemLoaderInterface *> m_loaders;
     QMap<QObject *, ItemLoaderInterface *> m_loaderChildren;
+
+    /** Loader which created item last time (key is hash of item data and formats). */
+    QHash<uint, ItemLoaderInterface *> m_loaderForItem;
 };
 
 #endif // ITEMFACTORY_H
@@ -31,7 +31,7 @@ class QModelIndex;
 class QPalette;
 class QWidget;
 
-#define COPYQ_PLUGIN_ITEM_LOADER_ID "org.CopyQ.ItemPlugin.ItemLoader/1.0"
+#define COPYQ_PLUGIN_ITEM_LOADER_ID "org.CopyQ.ItemPlugin.ItemLoader/1.1"
 
 #if QT_VERSION < 0x050000
 #   define Q_PLUGIN_METADATA(x)
@@ -131,6 +131,15 @@ public:
      */
     virtual ItemWidget *create(const QModelIndex &index, QWidget *parent) const = 0;
 
+    /**
+     * Return formats which can be displayed by the loader.
+     *
+     * create() is not called for items without any of these formats.
+     *
+     * Default implementation returns empty list which means any format.
+     */
+    virtual QStringList formatsToLoad() const { return QStringList(); }
+
     /**
      * Simple ID of plugin (e.g. part of plugin file name).
      */
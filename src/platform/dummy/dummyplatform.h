@@ -29,6 +29,8 @@ public:
 
     QString getWindowTitle(WId) { return QString(); }
 
+    QString getWindowClass(WId) { return QString(); }
+
     void raiseWindow(WId) {}
 
     void pasteToWindow(WId) {}
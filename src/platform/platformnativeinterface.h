@@ -42,6 +42,11 @@ public:
      */
     virtual QString getWindowTitle(WId wid) = 0;
 
+    /**
+     * Return class of window (unlike title, it's usually same for all windows of an application).
+     */
+    virtual QString getWindowClass(WId wid) = 0;
+
     /**
      * Raise and focus a window to foreground.
      */
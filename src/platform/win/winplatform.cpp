@@ -65,6 +65,17 @@ QString WinPlatform::getWindowTitle(WId wid)
 #   endif
 }
 
+QString WinPlatform::getWindowClass(WId wid)
+{
+    TCHAR buf[256];
+    GetClassName(wid, buf, 256);
+#   ifdef UNICODE
+    return QString::fromUtf16(reinterpret_cast<ushort *>(buf));
+#   else
+    return QString::fromLocal8Bit(buf);
+#   endif
+}
+
 void WinPlatform::raiseWindow(WId wid)
 {
     SetForegroundWindow(wid);
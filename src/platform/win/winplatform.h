@@ -31,6 +31,8 @@ public:
 
     QString getWindowTitle(WId wid);
 
+    QString getWindowClass(WId wid);
+
     void raiseWindow(WId wid);
 
     void pasteToWindow(WId wid);
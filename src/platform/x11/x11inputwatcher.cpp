@@ -0,0 +1,165 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "x11inputwatcher.h"
+
+#include <QSocketNotifier>
+
+#ifdef HAS_X11RECORD
+#   include <X11/Xlib.h>
+#   include <X11/keysym.h>
+#   include <X11/extensions/record.h>
+#endif
+
+class X11InputWatcherPrivate
+{
+public:
+    X11InputWatcherPrivate()
+        : notifier(NULL)
+#ifdef HAS_X11RECORD
+        , controlDisplay(NULL)
+        , dataDisplay(NULL)
+        , context(0)
+        , shiftLeft(0)
+        , shiftRight(0)
+        , released(false)
+#endif
+    {
+    }
+
+    QSocketNotifier *notifier;
+
+#ifdef HAS_X11RECORD
+    /** Display for creating record context. */
+    Display *controlDisplay;
+    /** Display receiving recorded events. */
+    Display *dataDisplay;
+    XRecordContext context;
+    KeyCode shiftLeft;
+    KeyCode shiftRight;
+    bool released;
+#endif
+};
+
+#ifdef HAS_X11RECORD
+namespace {
+
+void recordCallback(XPointer closure, XRecordInterceptData *data)
+{
+    X11InputWatcherPrivate *d = reinterpret_cast<X11InputWatcherPrivate *>(closure);
+
+    if (data->category == XRecordFromServer && data->data_len > 0) {
+        // Recorded data start with event type and detail (button or key code).
+        const int type = data->data[0] & 0x7f;
+        const int detail = data->data[1];
+        if ( (type == ButtonRelease && detail == Button1)
+             || (type == KeyRelease && (detail == d->shiftLeft || detail == d->shiftRight)) )
+        {
+            d->released = true;
+        }
+    }
+
+    XRecordFreeData(data);
+}
+
+} // namespace
+#endif
+
+X11InputWatcher::X11InputWatcher(QObject *parent)
+    : QObject(parent)
+    , d(new X11InputWatcherPrivate)
+{
+#ifdef HAS_X11RECORD
+    d->controlDisplay = XOpenDisplay(NULL);
+    d->dataDisplay = XOpenDisplay(NULL);
+    if (d->controlDisplay == NULL || d->dataDisplay == NULL)
+        return;
+
+    int major, minor;
+    if ( !XRecordQueryVersion(d->controlDisplay, &major, &minor) )
+        return;
+
+    d->shiftLeft = XKeysymToKeycode(d->controlDisplay, XK_Shift_L);
+    d->shiftRight = XKeysymToKeycode(d->controlDisplay, XK_Shift_R);
+
+    XRecordRange *range = XRecordAllocRange();
+    if (range == NULL)
+        return;
+    range->device_events.first = KeyRelease;
+    range->device_events.last = ButtonRelease;
+
+    XRecordClientSpec clients = XRecordAllClients;
+    d->context = XRecordCreateContext(d->controlDisplay, 0, &clients, 1, &range, 1);
+    XFree(range);
+    if (d->context == 0)
+        return;
+    XSync(d->controlDisplay, False);
+
+    if ( !XRecordEnableContextAsync(d->dataDisplay, d->context, recordCallback,
+                                    reinterpret_cast<XPointer>(d)) )
+    {
+        XRecordFreeContext(d->controlDisplay, d->context);
+        d->context = 0;
+        return;
+    }
+
+    d->notifier = new QSocketNotifier(ConnectionNumber(d->dataDisplay), QSocketNotifier::Read, this);
+    connect( d->notifier, SIGNAL(activated(int)),
+             this, SLOT(processReplies()) );
+
+    // Process replies already read by Xlib.
+    processReplies();
+#endif
+}
+
+X11InputWatcher::~X11InputWatcher()
+{
+    delete d->notifier;
+
+#ifdef HAS_X11RECORD
+    if (d->context != 0) {
+        XRecordDisableContext(d->controlDisplay, d->context);
+        XRecordFreeContext(d->controlDisplay, d->context);
+        XFlush(d->controlDisplay);
+    }
+    if (d->dataDisplay != NULL)
+        XCloseDisplay(d->dataDisplay);
+    if (d->controlDisplay != NULL)
+        XCloseDisplay(d->controlDisplay);
+#endif
+
+    delete d;
+}
+
+bool X11InputWatcher::isValid() const
+{
+    return d->notifier != NULL;
+}
+
+void X11InputWatcher::processReplies()
+{
+#ifdef HAS_X11RECORD
+    XRecordProcessReplies(d->dataDisplay);
+    if (d->released) {
+        d->released = false;
+        emit released();
+    }
+#endif
+}
@@ -0,0 +1,57 @@
+/*
+    Copyright (c) 2013, Lukas Holecek <hluk@email.cz>
+
+    This file is part of CopyQ.
+
+    CopyQ is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    CopyQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with CopyQ.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef X11INPUTWATCHER_H
+#define X11INPUTWATCHER_H
+
+#include <QObject>
+
+class X11InputWatcherPrivate;
+
+/**
+ * Watches global mouse button and key releases using X11 RECORD extension.
+ *
+ * Emits released() whenever left mouse button or shift key is released so
+ * user may have finished selecting text. This avoids polling pointer state.
+ */
+class X11InputWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit X11InputWatcher(QObject *parent = NULL);
+
+    ~X11InputWatcher();
+
+    /** Return true only if events can be watched (otherwise pointer state must be polled). */
+    bool isValid() const;
+
+signals:
+    /** Left mouse button or shift key was released. */
+    void released();
+
+private slots:
+    void processReplies();
+
+private:
+    X11InputWatcherPrivate *d;
+};
+
+#endif // X11INPUTWATCHER_H
@@ -5,7 +5,8 @@ if(NOT X11_Xfixes_FOUND)
 endif(NOT X11_Xfixes_FOUND)
 
 if(X11_XTest_FOUND)
-    add_definitions( -DHAS_X11TEST )
+    # RECORD extension is part of XTest library.
+    add_definitions( -DHAS_X11TEST -DHAS_X11RECORD )
     set(copyq_LIBRARIES ${X11_XTest_LIB})
 else(X11_XTest_FOUND)
     message(WARNING "X11 'TEST' extension library is needed to be able to"
@@ -19,6 +20,10 @@ file(GLOB copyq_SOURCES ${copyq_SOURCES}
     ../qxt/qxtglobalshortcut_x11.cpp
     )
 
+set(copyq_MOCABLE ${copyq_MOCABLE}
+    platform/x11/x11inputwatcher.h
+    )
+
 if (WITH_QT5)
     include_directories(${Qt5Gui_PRIVATE_INCLUDE_DIRS})
 endif()
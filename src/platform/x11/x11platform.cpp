@@ -21,6 +21,7 @@
 
 #include <X11/extensions/XTest.h>
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
 #include <X11/keysym.h>
 #include <X11/Xatom.h>
 #include <unistd.h> // usleep()
@@ -206,6 +207,22 @@ QString X11Platform::getWindowTitle(WId wid)
     return QString();
 }
 
+QString X11Platform::getWindowClass(WId wid)
+{
+    if (d->display == NULL || wid == 0L)
+        return QString();
+
+    XClassHint classHint;
+    if ( !XGetClassHint(d->display, wid, &classHint) )
+        return QString();
+
+    const QString result = QString::fromLocal8Bit(classHint.res_class);
+    XFree(classHint.res_name);
+    XFree(classHint.res_class);
+
+    return result;
+}
+
 void X11Platform::raiseWindow(WId wid)
 {
     if (d->display == NULL || wid == 0L)
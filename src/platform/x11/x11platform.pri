@@ -1,6 +1,8 @@
-DEFINES += COPYQ_WS_X11 HAS_X11TEST
+DEFINES += COPYQ_WS_X11 HAS_X11TEST HAS_X11RECORD
 LIBS    += -lX11 -lXfixes -lXtst
+HEADERS += platform/x11/x11inputwatcher.h
 SOURCES += platform/x11/x11platform.cpp \
+           platform/x11/x11inputwatcher.cpp \
            ../qxt/qxtglobalshortcut_x11.cpp
 USE_QXT = 1
 
@@ -22,11 +22,15 @@
 #include "common/client_server.h"
 #include "gui/configurationmanager.h"
 #include "item/clipboarditem.h"
+#include "item/clipboarditemjson.h"
 #include "../qt/bytearrayclass.h"
 #include "../qxt/qxtglobal.h"
 
 #include <QApplication>
+#include <QBuffer>
+#include <QDataStream>
 #include <QDir>
+#include <QFile>
 #include <QMimeData>
 #include <QScriptContext>
 #include <QScriptEngine>
@@ -41,6 +45,18 @@ const char *const programName = "CopyQ Clipboard Manager";
 
 const QString nl("\n");
 
+/// Maximum number of compiled scripts cached for eval().
+const int maxCachedPrograms = 100;
+
+/// Longer scripts are not cached.
+const int maxCachedScriptLength = 64 * 1024;
+
+/// Maximum number of imported items passed to GUI thread at once.
+const int maxImportBatchItems = 256;
+
+/// Maximum size of imported items passed to GUI thread at once.
+const int maxImportBatchBytes = 4 * 1024 * 1024;
+
 struct CommandHelp {
     CommandHelp()
         : cmd()
@@ -182,10 +198,18 @@ QList<CommandHelp> commandHelp()
            .addArg(Scriptable::tr("NEW_NAME"))
         << CommandHelp()
         << CommandHelp("exporttab",
-                       Scriptable::tr("Export items to file."))
+                       Scriptable::tr("Export items to file (or standard output if FILE_NAME is -)."))
            .addArg(Scriptable::tr("FILE_NAME"))
         << CommandHelp("importtab",
-                       Scriptable::tr("Import items from file."))
+                       Scriptable::tr("Import items from file (or standard input if FILE_NAME is -)."))
+           .addArg(Scriptable::tr("FILE_NAME"))
+        << CommandHelp("exportjson",
+                       Scriptable::tr("Export items to file in JSON format (one item per line).\n"
+                                      "Use standard output if FILE_NAME is -."))
+           .addArg(Scriptable::tr("FILE_NAME"))
+        << CommandHelp("importjson",
+                       Scriptable::tr("Import items from file in JSON format to new tab.\n"
+                                      "Use standard input if FILE_NAME is -."))
            .addArg(Scriptable::tr("FILE_NAME"))
         << CommandHelp()
         << CommandHelp("config",
@@ -204,6 +228,12 @@ QList<CommandHelp> commandHelp()
         << CommandHelp("session, -s, --session",
                        Scriptable::tr("\nStarts or connects to application instance with given session name."))
            .addArg(Scriptable::tr("SESSION"))
+        << CommandHelp("--session-stdin",
+                       Scriptable::tr("\nRead commands from standard input, one per line as\n"
+                                      "REQUEST_ID, COMMAND and ARGUMENTS separated by tabs.\n"
+                                      "Print line \"REQUEST_ID EXIT_CODE SIZE\" followed by\n"
+                                      "output of given SIZE and newline for each response\n"
+                                      "(exit code 0 means that command finished)."))
         << CommandHelp("help, -h, --help",
                        Scriptable::tr("\nPrint help for COMMAND or all commands."))
            .addArg("[" + Scriptable::tr("COMMAND") + "]")
@@ -264,7 +294,18 @@ Scriptable::Scriptable(ScriptableProxy *proxy, QObject *parent)
     , m_currentTab()
     , m_inputSeparator("\n")
     , m_currentPath()
+    , m_input(NULL)
+    , m_programs()
+    , m_programCacheHits(0)
+    , m_programCacheMisses(0)
+{
+}
+
+Scriptable::~Scriptable()
 {
+    COPYQ_LOG( QString("Compiled script cache: %1 hits, %2 misses")
+               .arg(m_programCacheHits)
+               .arg(m_programCacheMisses) );
 }
 
 void Scriptable::initEngine(QScriptEngine *eng, const QString &currentPath)
@@ -312,7 +353,7 @@ bool Scriptable::toInt(const QScriptValue &value, int &number) const
 QByteArray *Scriptable::toByteArray(const QScriptValue &value) const
 {
     if (value.scriptClass() == m_baClass)
-        return qscriptvalue_cast<QByteArray*>(value.data());
+        return ByteArrayClass::byteArray(value);
     else
         return NULL;
 }
@@ -567,7 +608,8 @@ void Scriptable::renametab()
 
 QScriptValue Scriptable::length()
 {
-    return m_proxy->length(currentTab());
+    const ClipboardModelSnapshotPtr snapshot = m_proxy->itemsSnapshot(currentTab());
+    return snapshot.isNull() ? 0 : snapshot->items.size();
 }
 
 void Scriptable::select()
@@ -649,11 +691,7 @@ void Scriptable::remove()
 
     int tab = currentTab();
 
-    qSort( rows.begin(), rows.end(), qGreater<int>() );
-
-    foreach (int row, rows)
-        m_proxy->removeRow(tab, row);
-
+    m_proxy->removeRows(tab, rows);
     m_proxy->delayedSaveItems(tab, 1000);
 }
 
@@ -670,7 +708,7 @@ void Scriptable::edit()
         if (i > 0)
             text.append( getInputSeparator() );
         if ( toInt(value, row) ) {
-            text.append( row >= 0 ? m_proxy->itemData(tab, row, defaultMime)
+            text.append( row >= 0 ? itemsData(tab, QList<int>() << row, defaultMime).value(0)
                                   : QString::fromUtf8(m_proxy->getClipboardData(defaultMime)) );
         } else {
             text.append( toString(value) );
@@ -690,28 +728,41 @@ void Scriptable::edit()
 
 QScriptValue Scriptable::read()
 {
-    QByteArray result;
+    QList<QByteArray> items;
+    QList<int> rows;
     QString mime(defaultMime);
     QScriptValue value;
-    QString sep = getInputSeparator();
 
     bool used = false;
     for ( int i = 0; i < argumentCount(); ++i ) {
         value = argument(i);
         int row;
         if ( toInt(value, row) ) {
-            if (used)
-                result.append(sep);
             used = true;
-            result.append( row >= 0 ? m_proxy->itemData(currentTab(), row, mime)
-                                    : m_proxy->getClipboardData(mime) );
+            if (row >= 0) {
+                rows.append(row);
+            } else {
+                appendItemsData(&rows, mime, &items);
+                items.append( m_proxy->getClipboardData(mime) );
+            }
         } else {
+            appendItemsData(&rows, mime, &items);
             mime = toString(value);
         }
     }
 
+    appendItemsData(&rows, mime, &items);
+
     if (!used)
-        result.append( m_proxy->getClipboardData(mime) );
+        items.append( m_proxy->getClipboardData(mime) );
+
+    QByteArray result;
+    const QByteArray sep = getInputSeparator().toUtf8();
+    for (int i = 0; i < items.size(); ++i) {
+        if (i > 0)
+            result.append(sep);
+        result.append(items[i]);
+    }
 
     return newByteArray(result);
 }
@@ -764,26 +815,29 @@ QScriptValue Scriptable::separator()
 void Scriptable::action()
 {
     QString text;
-    bool anyRows = false;
     int tab = currentTab();
     int i;
     QScriptValue value;
     QString sep = getInputSeparator();
 
+    QList<int> rows;
     for ( i = 0; i < argumentCount(); ++i ) {
         value = argument(i);
         int row;
         if (!toInt(value, row))
             break;
-        if (anyRows)
-            text.append(sep);
-        else
-            anyRows = true;
-        text.append( QString::fromUtf8(m_proxy->itemData(tab, row, defaultMime)) );
+        rows.append(row);
     }
 
-    if (!anyRows) {
+    if ( rows.isEmpty() ) {
         text = QString::fromUtf8( m_proxy->getClipboardData(defaultMime) );
+    } else {
+        const QList<QByteArray> items = itemsData(tab, rows, defaultMime);
+        for (int j = 0; j < items.size(); ++j) {
+            if (j > 0)
+                text.append(sep);
+            text.append( QString::fromUtf8(items[j]) );
+        }
     }
 
     if (i < argumentCount()) {
@@ -822,6 +876,9 @@ void Scriptable::exporttab()
     int tab = currentTab();
     if ( fileName.isNull() ) {
         throwError(argumentError());
+    } else if (fileName == "-") {
+        if ( !exportTabToClient(tab) )
+            throwError( tr("Cannot export tab to standard output!") );
     } else if ( !m_proxy->saveTab(getFileName(fileName), tab) ) {
         throwError( tr("Cannot save to file \"%1\"!").arg(fileName) );
     }
@@ -832,12 +889,53 @@ void Scriptable::importtab()
     const QString &fileName = arg(0);
     if ( fileName.isNull() ) {
         throwError(argumentError());
+    } else if (fileName == "-") {
+        if (m_input == NULL)
+            throwError( tr("Standard input is not available!") );
+        else if ( !importTabFromInput() )
+            throwError( tr("Cannot import tab from standard input!") );
     } else if ( !m_proxy->loadTab(getFileName(fileName)) ) {
         throwError(
             tr("Cannot import file \"%1\"!").arg(fileName) );
     }
 }
 
+void Scriptable::exportjson()
+{
+    const QString &fileName = arg(0);
+    int tab = currentTab();
+    if ( fileName.isNull() ) {
+        throwError(argumentError());
+    } else if (fileName == "-") {
+        if ( !exportTabJson(tab, NULL) )
+            throwError( tr("Cannot export tab to standard output!") );
+    } else {
+        QFile file( getFileName(fileName) );
+        if ( !file.open(QIODevice::WriteOnly) || !exportTabJson(tab, &file) )
+            throwError( tr("Cannot save to file \"%1\"!").arg(fileName) );
+    }
+}
+
+void Scriptable::importjson()
+{
+    const QString &fileName = arg(0);
+    int errorLine = 0;
+    if ( fileName.isNull() ) {
+        throwError(argumentError());
+    } else if (fileName == "-") {
+        if (m_input == NULL)
+            throwError( tr("Standard input is not available!") );
+        else if ( !importTabJson(m_input, &errorLine) )
+            throwError( tr("Cannot import tab from standard input (line %1)!").arg(errorLine) );
+    } else {
+        QFile file( getFileName(fileName) );
+        if ( !file.open(QIODevice::ReadOnly) )
+            throwError( tr("Cannot import file \"%1\"!").arg(fileName) );
+        else if ( !importTabJson(&file, &errorLine) )
+            throwError( tr("Cannot import file \"%1\" (line %2)!").arg(fileName).arg(errorLine) );
+    }
+}
+
 QScriptValue Scriptable::config()
 {
     const QString name = arg(0);
@@ -880,7 +978,16 @@ QScriptValue Scriptable::config()
 void Scriptable::eval()
 {
     const QString script = arg(0);
-    engine()->evaluate(script);
+
+    // Evaluate script in context of caller (not in global context).
+    QScriptContext *ctx = context();
+    QScriptContext *parent = ctx->parentContext();
+    if (parent != NULL) {
+        ctx->setActivationObject( parent->activationObject() );
+        ctx->setThisObject( parent->thisObject() );
+    }
+
+    engine()->evaluate( program(script) );
 }
 
 void Scriptable::currentpath()
@@ -914,6 +1021,204 @@ void Scriptable::abort()
         eng->abortEvaluation();
 }
 
+void Scriptable::appendItemsData(QList<int> *rows, const QString &mime, QList<QByteArray> *items)
+{
+    if ( rows->isEmpty() )
+        return;
+
+    items->append( itemsData(currentTab(), *rows, mime) );
+    rows->clear();
+}
+
+QList<QByteArray> Scriptable::itemsData(int tab, const QList<int> &rows, const QString &mime)
+{
+    QList<QByteArray> result;
+    const ClipboardModelSnapshotPtr snapshot = m_proxy->itemsSnapshot(tab);
+
+    foreach (int row, rows) {
+        if (row < 0) {
+            // Current item is known only in GUI thread.
+            result.append( m_proxy->itemData(tab, row, mime) );
+        } else if ( !snapshot.isNull() && row < snapshot->items.size() ) {
+            result.append( snapshot->items[row]->data(mime) );
+        } else {
+            result.append( QByteArray() );
+        }
+    }
+
+    return result;
+}
+
+bool Scriptable::exportTabToClient(int tab)
+{
+    const ClipboardModelSnapshotPtr snapshot = m_proxy->itemsSnapshot(tab);
+    const QString tabName = m_proxy->tabs().value(tab);
+    if ( snapshot.isNull() || tabName.isEmpty() )
+        return false;
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QDataStream out(&buffer);
+
+    // Same format as MainWindow::saveTab().
+    out << QByteArray("CopyQ v1") << tabName << snapshot->items.size();
+
+    foreach (const ClipboardItemSnapshotPtr &item, snapshot->items) {
+        out << *item;
+        if (buffer.size() >= messageChunkBytes) {
+            emit sendMessage(buffer.data(), CommandSuccess);
+            buffer.buffer().clear();
+            buffer.seek(0);
+        }
+    }
+
+    if (buffer.size() > 0)
+        emit sendMessage(buffer.data(), CommandSuccess);
+
+    return out.status() == QDataStream::Ok;
+}
+
+bool Scriptable::importTabFromInput()
+{
+    QDataStream in(m_input);
+
+    QByteArray header;
+    QString tabName;
+    in >> header >> tabName;
+    if ( !header.startsWith("CopyQ v1") || tabName.isEmpty() )
+        return false;
+
+    const int tab = m_proxy->createUniqueTab(tabName);
+
+    // Pass items to GUI thread in batches (same as in importTabJson()).
+    QList<QMimeData *> items;
+    int batchBytes = 0;
+    int length;
+    in >> length;
+    for (int i = 0; i < length && in.status() == QDataStream::Ok; ++i) {
+        ClipboardItem item;
+        in >> item;
+        if (in.status() != QDataStream::Ok)
+            break;
+
+        QMimeData *data = cloneData(*item.data());
+        items.append(data);
+        foreach ( const QString &format, data->formats() )
+            batchBytes += data->data(format).size();
+
+        if (items.size() >= maxImportBatchItems || batchBytes >= maxImportBatchBytes) {
+            m_proxy->appendItems(tab, items);
+            items.clear();
+            batchBytes = 0;
+        }
+    }
+
+    if ( !items.isEmpty() )
+        m_proxy->appendItems(tab, items);
+
+    m_proxy->delayedSaveItems(tab, 1000);
+
+    return in.status() == QDataStream::Ok;
+}
+
+bool Scriptable::exportTabJson(int tab, QIODevice *device)
+{
+    const ClipboardModelSnapshotPtr snapshot = m_proxy->itemsSnapshot(tab);
+    const QString tabName = m_proxy->tabs().value(tab);
+    if ( snapshot.isNull() || tabName.isEmpty() )
+        return false;
+
+    QByteArray bytes;
+    serializeTabHeaderJson(tabName, &bytes);
+
+    foreach (const ClipboardItemSnapshotPtr &item, snapshot->items) {
+        serializeItemJson(*item, &bytes);
+        if ( bytes.size() >= messageChunkBytes && !writeOutput(device, &bytes) )
+            return false;
+    }
+
+    return writeOutput(device, &bytes);
+}
+
+bool Scriptable::writeOutput(QIODevice *device, QByteArray *bytes)
+{
+    bool ok = true;
+    if (device == NULL)
+        emit sendMessage(*bytes, CommandSuccess);
+    else
+        ok = device->write(*bytes) == bytes->size();
+
+    bytes->clear();
+    return ok;
+}
+
+bool Scriptable::importTabJson(QIODevice *device, int *errorLine)
+{
+    ClipboardItemJsonReader reader(device);
+
+    QString tabName;
+    if ( !reader.readHeader(&tabName) ) {
+        *errorLine = reader.lineNumber();
+        return false;
+    }
+
+    const int tab = m_proxy->createUniqueTab(tabName);
+
+    // Pass items to GUI thread in batches so it's not called for each item
+    // and only few items are kept in memory.
+    QList<QMimeData *> items;
+    int batchBytes = 0;
+    while ( QMimeData *data = reader.readItem() ) {
+        const QStringList formats = data->formats();
+        if ( formats.isEmpty() ) {
+            delete data;
+            continue;
+        }
+
+        items.append(data);
+        foreach (const QString &format, formats)
+            batchBytes += data->data(format).size();
+
+        if (items.size() >= maxImportBatchItems || batchBytes >= maxImportBatchBytes) {
+            m_proxy->appendItems(tab, items);
+            items.clear();
+            batchBytes = 0;
+        }
+    }
+
+    if ( !items.isEmpty() )
+        m_proxy->appendItems(tab, items);
+
+    m_proxy->delayedSaveItems(tab, 1000);
+
+    if ( reader.hasError() ) {
+        *errorLine = reader.lineNumber();
+        return false;
+    }
+
+    return true;
+}
+
+QScriptProgram Scriptable::program(const QString &script)
+{
+    QHash<QString, QScriptProgram>::const_iterator it = m_programs.constFind(script);
+    if ( it != m_programs.constEnd() ) {
+        ++m_programCacheHits;
+        return it.value();
+    }
+
+    ++m_programCacheMisses;
+
+    const QScriptProgram program(script);
+    if (script.size() <= maxCachedScriptLength) {
+        if (m_programs.size() >= maxCachedPrograms)
+            m_programs.clear();
+        m_programs.insert(script, program);
+    }
+
+    return program;
+}
+
 int Scriptable::getTabIndexOrError(const QString &name)
 {
     int i = m_proxy->tabs().indexOf(name);
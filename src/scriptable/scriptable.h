@@ -22,13 +22,16 @@
 
 #include "scriptableproxy.h"
 
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QScriptable>
+#include <QScriptProgram>
 #include <QScriptValue>
 
 class ByteArrayClass;
 class ClipboardBrowser;
+class QIODevice;
 class QScriptEngine;
 
 class Scriptable : public QObject, protected QScriptable
@@ -41,6 +44,8 @@ class Scriptable : public QObject, protected QScriptable
 public:
     Scriptable(ScriptableProxy *proxy, QObject *parent = NULL);
 
+    ~Scriptable();
+
     void initEngine(QScriptEngine *engine, const QString &currentPath);
 
     QScriptValue newByteArray(const QByteArray &bytes);
@@ -68,6 +73,9 @@ public:
 
     QString getFileName(const QString &fileName) const;
 
+    /** Set client's standard input for importing tab (NULL if not available). */
+    void setInput(QIODevice *input) { m_input = input; }
+
     QString arg(int i, const QString &defaultValue = QString());
 
     void throwError(const QString &errorMessage);
@@ -118,6 +126,9 @@ public slots:
     void exporttab();
     void importtab();
 
+    void exportjson();
+    void importjson();
+
     QScriptValue config();
 
     void eval();
@@ -135,8 +146,47 @@ private:
     QString m_currentTab;
     QString m_inputSeparator;
     QString m_currentPath;
+    QIODevice *m_input;
+
+    /** Compiled scripts for eval() (engine is reused for many commands). */
+    QHash<QString, QScriptProgram> m_programs;
+    int m_programCacheHits;
+    int m_programCacheMisses;
 
     int getTabIndexOrError(const QString &name);
+
+    /** Return compiled @a script (from cache if it was evaluated before). */
+    QScriptProgram program(const QString &script);
+
+    /**
+     * Return data of items in @a rows.
+     * Items are read from snapshot of tab so GUI thread is not blocked.
+     */
+    QList<QByteArray> itemsData(int tab, const QList<int> &rows, const QString &mime);
+
+    /** Append data of items in @a rows of current tab to @a items and clear @a rows. */
+    void appendItemsData(QList<int> *rows, const QString &mime, QList<QByteArray> *items);
+
+    /** Send items in @a tab to client as they are serialized. */
+    bool exportTabToClient(int tab);
+
+    /** Import items from client's standard input, add each item as soon as it's read. */
+    bool importTabFromInput();
+
+    /**
+     * Write items in @a tab in JSON format to @a device
+     * (or send them to client if @a device is NULL).
+     */
+    bool exportTabJson(int tab, QIODevice *device);
+
+    /** Write @a bytes to @a device (or send them to client if @a device is NULL) and clear them. */
+    bool writeOutput(QIODevice *device, QByteArray *bytes);
+
+    /**
+     * Import items in JSON format to new tab.
+     * @return false on error (@a errorLine is set to line number)
+     */
+    bool importTabJson(QIODevice *device, int *errorLine);
 };
 
 #endif // SCRIPTABLE_H
@@ -23,6 +23,7 @@
 #include "gui/clipboardbrowser.h"
 #include "gui/mainwindow.h"
 #include "item/clipboarditem.h"
+#include "item/clipboardmodel.h"
 
 #include <QMetaObject>
 #include <QMimeData>
@@ -177,6 +178,10 @@
 
 /**
  * Invoke methods (of MainWindow and its ClipboardBrowser objects) from different thread.
+ *
+ * Each call blocks until GUI thread processes it so methods which work with
+ * many rows at once (removeRows()) should be preferred. Items should be read
+ * using itemsSnapshot().
  */
 class ScriptableProxy
 {
@@ -207,6 +212,7 @@ public:
     PROXY_METHOD_VOID_2(action, const QMimeData &, const Command &)
 
     PROXY_METHOD_1(bool, loadTab, const QString &)
+    PROXY_METHOD_1(int, createUniqueTab, const QString &)
     PROXY_METHOD_2(bool, saveTab, const QString &, int)
 
     PROXY_METHOD_VOID_4(showMessage, const QString &, const QString &,
@@ -220,17 +226,28 @@ public:
     PROXY_METHOD_BROWSER_VOID_1(moveToClipboard, int)
     PROXY_METHOD_BROWSER_VOID_1(delayedSaveItems, int)
     PROXY_METHOD_BROWSER_VOID_1(removeRow, int)
+    PROXY_METHOD_BROWSER_VOID_1(removeRows, const QList<int> &)
     PROXY_METHOD_BROWSER_VOID_1(setCurrent, int)
-    PROXY_METHOD_BROWSER_0(int, length)
     PROXY_METHOD_BROWSER_1(bool, openEditor, const QByteArray &)
 
     PROXY_METHOD_BROWSER_2(bool, add, const QString &, bool)
     PROXY_METHOD_BROWSER_3(bool, add, QMimeData *, bool, int)
+    PROXY_METHOD_BROWSER_VOID_1(appendItems, const QList<QMimeData *> &)
     PROXY_METHOD_BROWSER_VOID_1(editRow, int)
     PROXY_METHOD_BROWSER_VOID_1(editNew, const QString &)
 
     PROXY_METHOD_BROWSER_2(QByteArray, itemData, int, const QString &)
 
+    /**
+     * Return items in tab.
+     * Waits for GUI thread only if the tab changed since last snapshot.
+     */
+    ClipboardModelSnapshotPtr itemsSnapshot(int i)
+    {
+        ClipboardBrowser *browser = m_wnd->browser(i);
+        return browser != NULL ? browser->itemsSnapshot() : ClipboardModelSnapshotPtr();
+    }
+
 private:
     MainWindow *m_wnd;
 };
@@ -23,24 +23,298 @@
 #include "../qt/bytearrayclass.h"
 
 #include <QApplication>
+#include <QHash>
 #include <QLocalSocket>
+#include <QList>
+#include <QMutexLocker>
+#include <QPair>
 #include <QScriptEngine>
+#include <QScriptValueIterator>
 #include <QThread>
+#include <QThreadStorage>
+
+#include <cstring>
 
 Q_DECLARE_METATYPE(QByteArray*)
 
+namespace {
+
+/** Wait before sending more output while client hasn't received this many bytes. */
+const qint64 maxUnwrittenBytes = 4 * messageChunkBytes;
+
+/** Built-in objects which can be modified by commands (prototypes of constructors are checked too). */
+const char *const builtinObjects[] = {
+    "Object", "Function", "Array", "String", "Boolean", "Number", "Date", "RegExp", "Error",
+    "Math", "JSON", "ByteArray"
+};
+
+typedef QHash<QString, QScriptValue> ScriptProperties;
+
+ScriptProperties ownProperties(const QScriptValue &object)
+{
+    ScriptProperties properties;
+    QScriptValueIterator it(object);
+    while ( it.hasNext() ) {
+        it.next();
+        properties.insert( it.name(), it.value() );
+    }
+    return properties;
+}
+
+/** Return true only if @a object has exactly given own @a properties. */
+bool hasOwnProperties(const QScriptValue &object, const ScriptProperties &properties)
+{
+    int count = 0;
+    QScriptValueIterator it(object);
+    while ( it.hasNext() ) {
+        it.next();
+        ScriptProperties::const_iterator original = properties.find( it.name() );
+        if ( original == properties.end() || !it.value().strictlyEquals(original.value()) )
+            return false;
+        ++count;
+    }
+    return count == properties.size();
+}
+
+/**
+ * Initialized script engine reused for commands executed in the same thread.
+ *
+ * Each command runs in new context so declared variables and functions are
+ * not added to global object. Properties of global object are restored after
+ * each command so other global variables and overridden functions don't leak
+ * to next commands. If the command changed anything else (built-in objects or
+ * their prototypes) or global object cannot be restored, the engine must not
+ * be reused.
+ */
+class ScriptableEngine
+{
+public:
+    explicit ScriptableEngine(MainWindow *mainWindow)
+        : m_engine()
+        , m_proxy(mainWindow)
+        , m_scriptable(&m_proxy)
+        , m_mainWindow(mainWindow)
+        , m_globals()
+        , m_builtins()
+    {
+        m_scriptable.initEngine( &m_engine, QString() );
+
+        const QScriptValue globalObject = m_engine.globalObject();
+        m_globals = ownProperties(globalObject);
+
+        for ( size_t i = 0; i < sizeof(builtinObjects) / sizeof(builtinObjects[0]); ++i ) {
+            const QScriptValue object = globalObject.property( builtinObjects[i] );
+            if ( !object.isObject() )
+                continue;
+            m_builtins.append( qMakePair(object, ownProperties(object)) );
+
+            const QScriptValue prototype = object.property("prototype");
+            if ( prototype.isObject() )
+                m_builtins.append( qMakePair(prototype, ownProperties(prototype)) );
+        }
+    }
+
+    QScriptEngine &engine() { return m_engine; }
+
+    Scriptable &scriptable() { return m_scriptable; }
+
+    MainWindow *mainWindow() const { return m_mainWindow; }
+
+    /**
+     * Restore state after previous command.
+     * @return false if the state cannot be restored and engine must be recreated
+     */
+    bool restore()
+    {
+        m_engine.clearExceptions();
+
+        QScriptValue globalObject = m_engine.globalObject();
+        QScriptValueIterator it(globalObject);
+        while ( it.hasNext() ) {
+            it.next();
+            ScriptProperties::const_iterator original = m_globals.find( it.name() );
+            if ( original == m_globals.end() )
+                it.remove();
+            else if ( !it.value().strictlyEquals(original.value()) )
+                it.setValue( original.value() );
+        }
+
+        // Restore properties removed by command.
+        for ( ScriptProperties::const_iterator original = m_globals.constBegin();
+              original != m_globals.constEnd(); ++original )
+        {
+            if ( !globalObject.property(original.key()).isValid() )
+                globalObject.setProperty( original.key(), original.value() );
+        }
+
+        // Some properties cannot be removed or changed.
+        if ( !hasOwnProperties(globalObject, m_globals) )
+            return false;
+
+        for (int i = 0; i < m_builtins.size(); ++i) {
+            if ( !hasOwnProperties(m_builtins[i].first, m_builtins[i].second) )
+                return false;
+        }
+
+        return true;
+    }
+
+    /** Prepare engine for next command. */
+    void reset(const QString &currentPath)
+    {
+        m_scriptable.setCurrentTab( QString() );
+        m_scriptable.setInputSeparator("\n");
+        m_scriptable.setCurrentPath(currentPath);
+    }
+
+private:
+    QScriptEngine m_engine;
+    ScriptableProxy m_proxy;
+    Scriptable m_scriptable;
+    MainWindow *m_mainWindow;
+    /** Original properties of global object. */
+    ScriptProperties m_globals;
+    /** Built-in objects with their original properties. */
+    QList< QPair<QScriptValue, ScriptProperties> > m_builtins;
+};
+
+/** Engine for each thread (deleted when thread exits). */
+QThreadStorage<ScriptableEngine *> scriptableEngines;
+
+ScriptableEngine *threadScriptableEngine(MainWindow *mainWindow)
+{
+    ScriptableEngine *engine = scriptableEngines.localData();
+    if (engine != NULL && engine->mainWindow() == mainWindow) {
+        if ( engine->restore() )
+            return engine;
+        COPYQ_LOG("Previous command changed script engine state; creating new engine.");
+    }
+
+    // Previous engine is deleted.
+    engine = new ScriptableEngine(mainWindow);
+    scriptableEngines.setLocalData(engine);
+    return engine;
+}
+
+/** Connects worker with reused Scriptable object for lifetime of this object. */
+class ScriptableConnection
+{
+public:
+    ScriptableConnection(ScriptableWorker *worker, Scriptable *scriptable, bool hasClient,
+                         QIODevice *input)
+        : m_worker(worker)
+        , m_scriptable(scriptable)
+    {
+        m_scriptable->setInput(input);
+
+        if (hasClient) {
+            // Direct connection so the script waits if client doesn't read output fast enough.
+            QObject::connect( m_scriptable, SIGNAL(sendMessage(QByteArray,int)),
+                              m_worker, SLOT(onSendMessage(QByteArray,int)),
+                              Qt::DirectConnection );
+        }
+
+        QObject::connect( m_worker, SIGNAL(terminateScriptable()),
+                          m_scriptable, SLOT(abort()) );
+    }
+
+    ~ScriptableConnection()
+    {
+        m_scriptable->setInput(NULL);
+        QObject::disconnect(m_scriptable, 0, m_worker, 0);
+        QObject::disconnect(m_worker, 0, m_scriptable, 0);
+    }
+
+private:
+    ScriptableWorker *m_worker;
+    Scriptable *m_scriptable;
+};
+
+} // namespace
+
+ClientInputDevice::ClientInputDevice(ScriptableWorker *worker)
+    : QIODevice(worker)
+    , m_worker(worker)
+    , m_mutex()
+    , m_inputAdded()
+    , m_buffer()
+    , m_bufferPos(0)
+    , m_requested(false)
+    , m_finished(false)
+{
+    open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+void ClientInputDevice::addInput(const QByteArray &bytes)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_requested)
+        return;
+
+    m_requested = false;
+    if ( bytes.isEmpty() )
+        m_finished = true;
+    m_buffer = bytes;
+    m_bufferPos = 0;
+    m_inputAdded.wakeAll();
+}
+
+void ClientInputDevice::abort()
+{
+    QMutexLocker lock(&m_mutex);
+    m_finished = true;
+    m_inputAdded.wakeAll();
+}
+
+qint64 ClientInputDevice::readData(char *data, qint64 maxSize)
+{
+    QMutexLocker lock(&m_mutex);
+
+    // Block until requested size is available (QDataStream expects this).
+    qint64 bytesRead = 0;
+    while (bytesRead < maxSize) {
+        const int available = m_buffer.size() - m_bufferPos;
+        if (available > 0) {
+            const int n = static_cast<int>( qMin<qint64>(available, maxSize - bytesRead) );
+            memcpy( data + bytesRead, m_buffer.constData() + m_bufferPos, n );
+            m_bufferPos += n;
+            bytesRead += n;
+        } else if (m_finished) {
+            break;
+        } else {
+            if (!m_requested) {
+                m_requested = true;
+                m_worker->requestInput();
+            }
+            m_inputAdded.wait(&m_mutex);
+        }
+    }
+
+    return bytesRead;
+}
+
 ScriptableWorker::ScriptableWorker(MainWindow *mainWindow, const Arguments &args,
-                                   QLocalSocket *client, QObject *parent)
+                                   QLocalSocket *client, int requestId, QObject *parent)
     : QObject(parent)
     , QRunnable()
     , m_wnd(mainWindow)
     , m_args(args)
     , m_client(client)
+    , m_requestId(requestId)
     , m_terminated(false)
+    , m_input(new ClientInputDevice(this))
+    , m_writeMutex()
+    , m_messagesWritten()
+    , m_unwrittenBytes(0)
 {
     setAutoDelete(false);
 }
 
+void ScriptableWorker::requestInput()
+{
+    emit sendMessage(m_client, QByteArray(), CommandReadInput, m_requestId);
+}
+
 void ScriptableWorker::run()
 {
     if (!m_terminated) {
@@ -52,29 +326,70 @@ void ScriptableWorker::run()
 
             if ( exitCode == CommandBadSyntax )
                 response = tr("Bad command syntax. Use -h for help.\n").toLocal8Bit();
-            emit sendMessage(m_client, response, exitCode);
-
-            emit sendMessage(m_client, QByteArray(), CommandFinished);
+            sendMessageToClient(response, exitCode);
         }
     }
 
+    // Server waits for this message before releasing client (even if terminated).
+    if (m_client != NULL)
+        sendMessageToClient(QByteArray(), CommandFinished);
+
     emit finished();
 }
 
 void ScriptableWorker::terminate()
 {
-    m_terminated = true;
+    {
+        QMutexLocker lock(&m_writeMutex);
+        m_terminated = true;
+        m_messagesWritten.wakeAll();
+    }
+    m_input->abort();
     emit terminateScriptable();
 }
 
+void ScriptableWorker::addInput(const QByteArray &bytes)
+{
+    m_input->addInput(bytes);
+}
+
 void ScriptableWorker::onSendMessage(const QByteArray &message, int exitCode)
 {
     if (m_client != NULL)
-        emit sendMessage(m_client, message, exitCode);
+        sendMessageToClient(message, exitCode);
     else
         QApplication::exit(0);
 }
 
+void ScriptableWorker::onMessagesWritten(qint64 bytes)
+{
+    QMutexLocker lock(&m_writeMutex);
+    m_unwrittenBytes = qMax<qint64>(0, m_unwrittenBytes - bytes);
+    m_messagesWritten.wakeAll();
+}
+
+void ScriptableWorker::sendMessageToClient(const QByteArray &message, int exitCode)
+{
+    // Client exits after receiving other messages so only output can be split.
+    const int chunkSize = (exitCode == CommandSuccess) ? messageChunkBytes : message.size();
+
+    int i = 0;
+    do {
+        const QByteArray chunk = (i == 0 && message.size() <= chunkSize)
+                ? message : message.mid(i, chunkSize);
+        i += chunkSize;
+
+        {
+            QMutexLocker lock(&m_writeMutex);
+            while (m_unwrittenBytes > maxUnwrittenBytes && !m_terminated)
+                m_messagesWritten.wait(&m_writeMutex);
+            m_unwrittenBytes += chunk.size();
+        }
+
+        emit sendMessage(m_client, chunk, exitCode, m_requestId);
+    } while ( i < message.size() );
+}
+
 CommandStatus ScriptableWorker::executeScript(QByteArray *response)
 {
 #ifdef COPYQ_LOG_DEBUG
@@ -89,18 +404,14 @@ CommandStatus ScriptableWorker::executeScript(QByteArray *response)
     }
     const QString cmd = QString::fromUtf8( m_args.at(Arguments::Rest) );
 
-    QScriptEngine engine;
-    ScriptableProxy proxy(m_wnd);
-    Scriptable scriptable(&proxy);
-    scriptable.abort();
-    scriptable.initEngine( &engine, QString::fromUtf8(m_args.at(Arguments::CurrentPath)) );
-    if (m_client != NULL) {
-        connect(&scriptable, SIGNAL(sendMessage(QByteArray,int)),
-                SLOT(onSendMessage(QByteArray,int)));
-    }
+    ScriptableEngine *scriptableEngine = threadScriptableEngine(m_wnd);
+    QScriptEngine &engine = scriptableEngine->engine();
+    Scriptable &scriptable = scriptableEngine->scriptable();
+    scriptableEngine->reset( QString::fromUtf8(m_args.at(Arguments::CurrentPath)) );
 
-    connect( this, SIGNAL(terminateScriptable()),
-             &scriptable, SLOT(abort()) );
+    // Standard input can be streamed only from clients outside session.
+    QIODevice *input = (m_client != NULL && m_requestId < 0) ? m_input : NULL;
+    ScriptableConnection connection(this, &scriptable, m_client != NULL, input);
 
     QScriptValue result;
     QScriptValueList fnArgs;
@@ -114,7 +425,10 @@ CommandStatus ScriptableWorker::executeScript(QByteArray *response)
     for ( int i = Arguments::Rest + 1; i < m_args.length(); ++i )
         fnArgs.append( scriptable.newByteArray(m_args.at(i)) );
 
+    // Variables and functions declared by command are local to this context.
+    engine.pushContext();
     result = fn.call(QScriptValue(), fnArgs);
+    engine.popContext();
 
     if ( engine.hasUncaughtException() ) {
         COPYQ_LOG( msg.arg("command error (\"%1\")").arg(cmd) );
@@ -124,10 +438,10 @@ CommandStatus ScriptableWorker::executeScript(QByteArray *response)
         return CommandError;
     }
 
-    QByteArray *bytes = qscriptvalue_cast<QByteArray*>(result.data());
+    QByteArray *bytes = ByteArrayClass::byteArray(result);
     if (response != NULL) {
         if (bytes != NULL)
-            response->append(*bytes);
+            *response = *bytes; // implicitly shared, no copy
         else if (!result.isUndefined())
             response->append(result.toString() + '\n');
     }
@@ -23,21 +23,58 @@
 #include "common/arguments.h"
 #include "common/client_server.h"
 
+#include <QIODevice>
+#include <QMutex>
 #include <QRunnable>
 #include <QObject>
+#include <QWaitCondition>
 
 class MainWindow;
 class QLocalSocket;
+class ScriptableWorker;
+
+/**
+ * Client's standard input read from worker thread.
+ *
+ * Next chunk is requested from client only after previous one was read so
+ * at most one chunk is kept in memory.
+ */
+class ClientInputDevice : public QIODevice
+{
+public:
+    explicit ClientInputDevice(ScriptableWorker *worker);
+
+    bool isSequential() const { return true; }
+
+    /** Add chunk received from client (empty chunk ends input). */
+    void addInput(const QByteArray &bytes);
+
+    /** Stop waiting for input. */
+    void abort();
+
+protected:
+    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *, qint64) { return -1; }
+
+private:
+    ScriptableWorker *m_worker;
+    QMutex m_mutex;
+    QWaitCondition m_inputAdded;
+    QByteArray m_buffer;
+    int m_bufferPos;
+    bool m_requested;
+    bool m_finished;
+};
 
 class ScriptableWorker : public QObject, public QRunnable
 {
     Q_OBJECT
 public:
     ScriptableWorker(MainWindow *mainWindow, const Arguments &args, QLocalSocket *client,
-                     QObject *parent = NULL);
+                     int requestId = -1, QObject *parent = NULL);
 
 signals:
-    void sendMessage(QLocalSocket *client, const QByteArray &message, int exitCode);
+    void sendMessage(QLocalSocket *client, const QByteArray &message, int exitCode, int requestId);
     void finished();
     void terminateScriptable();
 
@@ -45,16 +82,42 @@ public slots:
     void run();
     void terminate();
 
+    /** Pass chunk of client's standard input to script. */
+    void addInput(const QByteArray &bytes);
+
+    /** Called when @a bytes of messages for client were written to socket. */
+    void onMessagesWritten(qint64 bytes);
+
 private slots:
     void onSendMessage(const QByteArray &message, int exitCode);
 
 private:
+    friend class ClientInputDevice;
+
     CommandStatus executeScript(QByteArray *response = NULL);
 
+    /** Ask client for next chunk of standard input (called from worker thread). */
+    void requestInput();
+
+    /**
+     * Send message to client (called from worker thread).
+     *
+     * Successful output is split into chunks and the method waits while too
+     * many bytes sent earlier were not yet written to client.
+     */
+    void sendMessageToClient(const QByteArray &message, int exitCode);
+
     MainWindow *m_wnd;
     Arguments m_args;
     QLocalSocket *m_client;
+    int m_requestId;
     bool m_terminated;
+    ClientInputDevice *m_input;
+
+    QMutex m_writeMutex;
+    QWaitCondition m_messagesWritten;
+    /** Bytes sent to client which are not yet written to socket. */
+    qint64 m_unwrittenBytes;
 };
 
 #endif // SCRIPTABLEWORKER_H
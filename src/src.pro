@@ -21,10 +21,15 @@ HEADERS += \
     app/clipboardserver.h \
     app/remoteprocess.h \
     common/action.h \
+    common/actionscheduler.h \
     common/arguments.h \
     common/client_server.h \
     common/command.h \
+    common/commandmatcher.h \
     common/contenttype.h \
+    common/messagereader.h \
+    common/messagewriter.h \
+    common/mimedatacodec.h \
     common/option.h \
     gui/aboutdialog.h \
     gui/actiondialog.h \
@@ -41,6 +46,7 @@ HEADERS += \
     gui/tabwidget.h \
     gui/traymenu.h \
     item/clipboarditem.h \
+    item/clipboarditemjson.h \
     item/clipboardmodel.h \
     item/itemdelegate.h \
     item/itemeditor.h \
@@ -61,8 +67,13 @@ SOURCES += \
     app/clipboardserver.cpp \
     app/remoteprocess.cpp \
     common/action.cpp \
+    common/actionscheduler.cpp \
     common/arguments.cpp \
     common/client_server.cpp \
+    common/commandmatcher.cpp \
+    common/messagereader.cpp \
+    common/messagewriter.cpp \
+    common/mimedatacodec.cpp \
     common/option.cpp \
     gui/aboutdialog.cpp \
     gui/actiondialog.cpp \
@@ -79,6 +90,7 @@ SOURCES += \
     gui/tabwidget.cpp \
     gui/traymenu.cpp \
     item/clipboarditem.cpp \
+    item/clipboarditemjson.cpp \
     item/clipboardmodel.cpp \
     item/itemdelegate.cpp \
     item/itemeditor.cpp \
@@ -21,15 +21,18 @@
 
 #include "app/remoteprocess.h"
 #include "common/client_server.h"
-#include "item/clipboarditem.h"
+#include "common/command.h"
+#include "common/commandmatcher.h"
 
 #include <QApplication>
 #include <QClipboard>
+#include <QElapsedTimer>
 #include <QLocalServer>
 #include <QLocalSocket>
 #include <QMimeData>
 #include <QProcess>
 #include <QTemporaryFile>
+#include <QTextCodec>
 #include <QTest>
 
 using QTest::qSleep;
@@ -137,6 +140,7 @@ Tests::Tests(QObject *parent)
     : QObject(parent)
     , m_server(NULL)
     , m_monitor(NULL)
+    , m_monitorCodec()
 {
 }
 
@@ -200,6 +204,89 @@ void Tests::clipboardToItem()
     QCOMPARE( getClipboard().data(), "TEST2" );
     RUN(Args("clipboard"), "TEST2");
     RUN(Args("read") << "0", "TEST2");
+
+    // Same data set again.
+    setClipboard("TEST2");
+    RUN(Args("read") << "0", "TEST2");
+    RUN(Args("read") << "1", "TEST1");
+
+    setClipboard("TEST1");
+    RUN(Args("read") << "0", "TEST1");
+}
+
+void Tests::clipboardToItemAgain()
+{
+    // Same data copied again after the item was removed.
+    setClipboard("TEST_AGAIN");
+    RUN(Args("read") << "0", "TEST_AGAIN");
+    RUN(Args("remove") << "0", "");
+    setClipboard("TEST_AGAIN");
+    RUN(Args("read") << "0", "TEST_AGAIN");
+
+    // Same text with different HTML.
+    QMimeData data;
+    data.setData("text/plain", "TEST_HTML");
+    data.setData("text/html", "<b>TEST_HTML</b>");
+    setClipboard(data);
+    RUN(Args("read") << "text/html" << "0", "<b>TEST_HTML</b>");
+
+    data.setData("text/html", "<i>TEST_HTML</i>");
+    setClipboard(data);
+    RUN(Args("read") << "text/html" << "0", "<i>TEST_HTML</i>");
+    RUN(Args("read") << "text/plain" << "0", "TEST_HTML");
+}
+
+void Tests::largeClipboardToItem()
+{
+    // Data are passed between server and monitor in shared memory
+    // and sent to client in multiple chunks.
+    const int minSize = qMax( MimeDataCodec::sharedMemoryMinBytes(), messageChunkBytes );
+    QByteArray data;
+    while (data.size() <= minSize)
+        data.append("TEST_LARGE_DATA ");
+
+    setClipboard(data);
+    QCOMPARE( getClipboard(), data );
+    RUN(Args("read") << "0", data);
+}
+
+void Tests::sharedMemoryRelease()
+{
+    QByteArray bytes;
+    while (bytes.size() <= MimeDataCodec::sharedMemoryMinBytes())
+        bytes.append("TEST_LARGE_DATA ");
+
+    // Segments are kept until receiver releases them (regardless of their count).
+    MimeDataCodec codec;
+    QList<QByteArray> messages;
+    for (int i = 0; i < 20; ++i) {
+        QMimeData data;
+        data.setData("text/plain", bytes + QByteArray::number(i));
+        messages.append( codec.serialize(data) );
+    }
+    QCOMPARE( codec.sharedSegmentCount(), 20 );
+
+    QStringList keys;
+    for (int i = 0; i < messages.size(); ++i) {
+        QMimeData data;
+        QVERIFY( MimeDataCodec::deserialize(messages[i], &data, &keys) );
+        QCOMPARE( data.data("text/plain"), bytes + QByteArray::number(i) );
+    }
+    QCOMPARE( keys.size(), 20 );
+
+    // Receiver acknowledges the data.
+    QMimeData release;
+    QVERIFY( MimeDataCodec::deserialize(MimeDataCodec::releaseMessage(keys.mid(0, 5)), &release) );
+    QVERIFY( codec.release(release) );
+    QCOMPARE( codec.sharedSegmentCount(), 15 );
+
+    QMimeData other;
+    other.setData("text/plain", "TEST");
+    QVERIFY( !codec.release(other) );
+    QCOMPARE( codec.sharedSegmentCount(), 15 );
+
+    codec.releaseAll();
+    QCOMPARE( codec.sharedSegmentCount(), 0 );
 }
 
 void Tests::itemToClipboard()
@@ -252,6 +339,7 @@ void Tests::tabAddRemove()
     RUN(Args(args) << "read" << "1", "def");
     RUN(Args(args) << "read" << "2", "abc");
     RUN(Args(args) << "read" << "0" << "2" << "1", "ghi\nabc\ndef");
+    RUN(Args(args) << "read" << "text/plain" << "0" << "1" << "?" << "2", "ghi\ndef\ntext/plain\n");
 
     // Restart server.
     QVERIFY( stopServer() );
@@ -297,6 +385,27 @@ void Tests::action()
     RUN(Args(args) << "read" << "2", "A");
 }
 
+void Tests::actionOutput()
+{
+    const Args args = Args("tab") << testTabs.arg(1);
+    const Args argsAction = Args(args) << "action";
+
+    // Separator is split between two reads of command output.
+    RUN(Args(argsAction) << "sh -c \"printf 'a;'; sleep 0.1; printf ';b'\"" << ";;", "");
+    qSleep(2 * waitMsAction);
+    RUN(Args(args) << "size", "2\n");
+    RUN(Args(args) << "read" << "0", "b");
+    RUN(Args(args) << "read" << "1", "a");
+
+    // Multibyte character (UTF-8 "\u00e9") is split between two reads of command output.
+    if ( QTextCodec::codecForLocale()->name() == "UTF-8" ) {
+        RUN(Args(argsAction) << "sh -c \"printf '\\\\303'; sleep 0.1; printf '\\\\251'\"" << "\n", "");
+        qSleep(2 * waitMsAction);
+        RUN(Args(args) << "size", "3\n");
+        RUN(Args(args) << "read" << "0", "\xc3\xa9");
+    }
+}
+
 void Tests::insertRemoveItems()
 {
     const Args args = Args("tab") << testTabs.arg(1);
@@ -388,6 +497,62 @@ void Tests::importExportTab()
 
     RUN(Args(args) << "importtab" << tmp.fileName(), "");
     RUN(Args(args) << "read" << "0" << "1" << "2", "ghi\ndef\nabc");
+
+    // Export to standard output and import from standard input.
+    QByteArray exported;
+    QByteArray stderrData;
+    QCOMPARE( run(Args(args) << "exporttab" << "-", &exported, &stderrData), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+
+    tmp.seek(0);
+    QCOMPARE( exported, tmp.readAll() );
+
+    RUN(Args("removetab") << tab, "");
+    QVERIFY( !hasTab(tab) );
+
+    QCOMPARE( run(Args("importtab") << "-", NULL, &stderrData, exported), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+    RUN(Args(args) << "read" << "0" << "1" << "2", "ghi\ndef\nabc");
+}
+
+void Tests::importExportJson()
+{
+    const QString tab = testTabs.arg(1);
+    const Args args = Args("tab") << tab;
+
+    RUN(Args(args) << "add" << "abc" << "def\n\"quoted\"" << "ghi", "");
+
+    QByteArray stderrData;
+    QCOMPARE( run(Args(args) << "write" << "application/x-copyq-test" << "-",
+                  NULL, &stderrData, QByteArray("\xff\x00\x01", 3)), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+
+    QByteArray exported;
+    QCOMPARE( run(Args(args) << "exportjson" << "-", &exported, &stderrData), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+
+    const QList<QByteArray> lines = exported.split('\n');
+    QCOMPARE( lines.size(), 6 );
+    QCOMPARE( lines[0], QString("{\"copyq\":1,\"tab\":\"%1\"}").arg(tab).toUtf8() );
+    QVERIFY2( lines[1].contains("\"base64\":"), lines[1] );
+    QCOMPARE( lines[3], QByteArray("{\"formats\":{\"text/plain\":{\"text\":\"def\\n\\\"quoted\\\"\"}}}") );
+
+    RUN(Args("removetab") << tab, "");
+    QVERIFY( !hasTab(tab) );
+
+    QCOMPARE( run(Args("importjson") << "-", NULL, &stderrData, exported), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+    RUN(Args(args) << "read" << "1" << "2" << "3", "ghi\ndef\n\"quoted\"\nabc");
+    RUN(Args(args) << "size", "4\n");
+
+    QByteArray reexported;
+    QCOMPARE( run(Args(args) << "exportjson" << "-", &reexported, &stderrData), 0 );
+    QCOMPARE( reexported, exported );
+
+    // Invalid input.
+    RUN(Args("removetab") << tab, "");
+    QVERIFY( run(Args("importjson") << "-", NULL, &stderrData, exported.left(exported.size() - 10)) != 0 );
+    QVERIFY( stderrData.contains("line 5") );
 }
 
 void Tests::separator()
@@ -419,6 +584,30 @@ void Tests::eval()
     RUN(Args("eval") << QString("tab('%1');if (str(read(0)) === 'def') print('ok')").arg(tab2), "ok");
 }
 
+void Tests::byteArrayViews()
+{
+    const QString tab = testTabs.arg(1);
+    const Args args = Args("tab") << tab;
+
+    RUN(Args(args) << "add" << "abc,def,ghi", "");
+
+    RUN(Args(args) << "eval" << "print(read(0).mid(4, 3))", "def");
+    RUN(Args(args) << "eval" << "print(str(read(0).left(3)) + str(read(0).right(3)))", "abcghi");
+    RUN(Args(args) << "eval" << "print(read(0).split(',')[2])", "ghi");
+    RUN(Args(args) << "eval" << "print(read(0).indexOf('def') + ' ' + read(0).lastIndexOf(','))", "4 7");
+    RUN(Args(args) << "eval" << "print(read(0).count(',') + ' ' + read(0).startsWith('abc'))", "2 true");
+
+    // Modifying view must not change source data.
+    RUN(Args(args) << "eval" << "var a = read(0); var b = a.mid(4); b.chop(2); print(str(b) + ';' + str(a))",
+        "def,g;abc,def,ghi");
+    RUN(Args(args) << "eval" << "var a = read(0); var b = a.left(3); a.truncate(1); print(str(b) + ';' + str(a))",
+        "abc;a");
+
+    // View passed back to server is copied.
+    RUN(Args(args) << "eval" << "add(read(0).mid(4, 3))", "");
+    RUN(Args(args) << "read" << "0", "def");
+}
+
 void Tests::rawData()
 {
     const QString tab = testTabs.arg(1);
@@ -449,6 +638,188 @@ void Tests::rawData()
     }
 }
 
+void Tests::session()
+{
+    const QString tab = testTabs.arg(1);
+    const Args args = Args("tab") << tab;
+
+    RUN(Args(args) << "add" << "abc" << "def", "");
+
+    // Requests are sent at once and can run in parallel.
+    const QByteArray in = QString(
+                "1\ttab\t%1\tread\t0\n"
+                "2\ttab\t%1\tsize\n"
+                "3\tbad_command\n").arg(tab).toLatin1();
+
+    QByteArray stdoutData;
+    QByteArray stderrData;
+    QCOMPARE( run(Args("--session-stdin"), &stdoutData, &stderrData, in), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+
+    // Responses can arrive in any order.
+    QVERIFY2( stdoutData.contains("1 3 3\ndef\n"), stdoutData );
+    QVERIFY2( stdoutData.contains("1 0 0\n\n"), stdoutData );
+    QVERIFY2( stdoutData.contains("2 3 2\n2\n\n"), stdoutData );
+    QVERIFY2( stdoutData.contains("2 0 0\n\n"), stdoutData );
+    QVERIFY2( stdoutData.contains("3 2 "), stdoutData );
+    QVERIFY2( stdoutData.contains("3 0 0\n\n"), stdoutData );
+}
+
+void Tests::globalState()
+{
+    // Scripting engines are reused so global state must be cleared after each command.
+    RUN(Args("eval") << "x = 1; read = function() { return 'x'; }; currentTab = 'abc'", "");
+    RUN(Args("eval") << "print(typeof x)", "undefined");
+    RUN(Args("eval") << "print(typeof read(0))", "object");
+    RUN(Args("eval") << "print(currentTab)", "");
+
+    // Variables and functions declared by command are local to the command.
+    RUN(Args("eval") << "var y = 1; function z() {}; print(typeof y + ' ' + typeof z)",
+        "number function");
+    RUN(Args("eval") << "print(typeof y + ' ' + typeof z)", "undefined undefined");
+
+    // Built-in objects and their prototypes.
+    RUN(Args("eval") << "String.prototype.x = 1; Math.x = 2; JSON.x = 3; ByteArray.prototype.x = 4", "");
+    RUN(Args("eval") << "print(typeof ''.x + ' ' + typeof Math.x + ' ' + typeof JSON.x)",
+        "undefined undefined undefined");
+    RUN(Args("eval") << "print(typeof new ByteArray().x)", "undefined");
+}
+
+void Tests::commandsPerSecond()
+{
+    const QString tab = testTabs.arg(1);
+    const int count = 200;
+
+    // Half of the commands declare variables (engine is reused anyway).
+    QByteArray in;
+    for (int i = 0; i < count; ++i) {
+        const char *command = (i % 2 == 0) ? "size" : "eval\tvar n = size()";
+        in.append( QString("%1\ttab\t%2\t%3\n").arg(i).arg(tab).arg(command).toLatin1() );
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QByteArray stdoutData;
+    QByteArray stderrData;
+    QCOMPARE( run(Args("--session-stdin"), &stdoutData, &stderrData, in), 0 );
+    QVERIFY2( testStderr(stderrData), stderrData );
+
+    const qint64 elapsed = qMax<qint64>(1, timer.elapsed());
+    QCOMPARE( stdoutData.count(" 0 0\n"), count );
+
+    qDebug( "%d commands in %lld ms (%lld commands per second)",
+            count, elapsed, count * 1000 / elapsed );
+}
+
+void Tests::evalPerSecond()
+{
+    const int count = 200;
+
+    QString script;
+    for (int i = 0; i < 100; ++i)
+        script.append( QString("var x%1 = function(a) { return a + %1; }(%1); ").arg(i) );
+
+    // Same script is compiled only once; unique scripts (differ in comment) are compiled each time.
+    qint64 elapsed[2];
+    for (int unique = 0; unique < 2; ++unique) {
+        QByteArray in;
+        for (int i = 0; i < count; ++i) {
+            const QString comment = unique ? QString("/*%1*/").arg(i) : QString();
+            in.append( QString("%1\teval\t%2\n").arg(i).arg(comment + script).toLatin1() );
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+
+        QByteArray stdoutData;
+        QByteArray stderrData;
+        QCOMPARE( run(Args("--session-stdin"), &stdoutData, &stderrData, in), 0 );
+        QVERIFY2( testStderr(stderrData), stderrData );
+
+        elapsed[unique] = qMax<qint64>(1, timer.elapsed());
+        QCOMPARE( stdoutData.count(" 0 0\n"), count );
+    }
+
+    qDebug( "same script: %lld evaluations per second, unique scripts: %lld evaluations per second",
+            count * 1000 / elapsed[0], count * 1000 / elapsed[1] );
+}
+
+void Tests::commandMatcher()
+{
+    // Matcher must give same result as regular expression alone.
+    const char *const cases[][2] = {
+        // escape sequences
+        {"\\x41", "A"},
+        {"\\x41", "x41"},
+        {"\\x0041B", "AB"},
+        {"\\0101", "A"},
+        {"\\0101", "0101"},
+        {"a\\nb", "a\nb"},
+        {"\\.txt$", "file.txt"},
+        {"\\.txt$", "filetxt"},
+        {"(a)\\1b", "aab"},
+        {"(a)\\1b", "a1b"},
+        {"\\d+ items", "12 items"},
+        {"\\bword\\b", "a word"},
+        // quantifiers
+        {"ab?c", "ac"},
+        {"ab*c", "ac"},
+        {"ab+c", "abbc"},
+        {"ab{0,2}c", "ac"},
+        {"abc{2}", "abcc"},
+        {"abc{2}", "abc"},
+        // groups
+        {"x(abc)?y", "xy"},
+        {"x(abc)+y", "xabcabcy"},
+        {"(?:abc)?d", "d"},
+        {"a(b|c)d", "acd"},
+        // character classes
+        {"a[bc]d", "acd"},
+        {"a[^b]d", "a-d"},
+        {"a[]x]d", "a]d"},
+        {"a[\\]]d", "a]d"},
+        {"[a-z]+@example", "me@example"},
+        // alternatives and plain text
+        {"abc|def", "def"},
+        {"abc", "xabcx"},
+        {"abc", "ab"},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        const QString pattern = cases[i][0];
+        const QString text = cases[i][1];
+
+        Command c;
+        c.automatic = true;
+        c.cmd = "copyq";
+        c.re = QRegExp(pattern);
+
+        CommandMatcher matcher;
+        matcher.setCommands(QList<Command>() << c);
+
+        QMimeData data;
+        data.setText(text);
+
+        const bool expected = QRegExp(pattern).indexIn(text) != -1;
+        const QByteArray message = QString("pattern \"%1\", text \"%2\"").arg(pattern, text).toUtf8();
+        QVERIFY2( !matcher.match(data).isEmpty() == expected, message.constData() );
+    }
+
+    // Literal text in case-insensitive expression.
+    Command c;
+    c.automatic = true;
+    c.cmd = "copyq";
+    c.re = QRegExp("A\\x42c", Qt::CaseInsensitive);
+
+    CommandMatcher matcher;
+    matcher.setCommands(QList<Command>() << c);
+
+    QMimeData data;
+    data.setText("xabCx");
+    QVERIFY( !matcher.match(data).isEmpty() );
+}
+
 bool Tests::startServer()
 {
     if (m_server != NULL)
@@ -488,6 +859,13 @@ bool Tests::isServerRunning()
 }
 
 void Tests::setClipboard(const QByteArray &bytes, const QString &mime)
+{
+    QMimeData data;
+    data.setData(mime, bytes);
+    setClipboard(data);
+}
+
+void Tests::setClipboard(const QMimeData &data)
 {
     if (m_monitor == NULL) {
         m_monitor = new RemoteProcess();
@@ -497,16 +875,8 @@ void Tests::setClipboard(const QByteArray &bytes, const QString &mime)
 
     QVERIFY( m_monitor->isConnected() );
 
-    // Create item.
-    ClipboardItem item;
-    item.setData(mime, bytes);
-
-    // Send item.
-    QByteArray msg;
-    QDataStream out(&msg, QIODevice::WriteOnly);
-    out << item;
-
-    QVERIFY( m_monitor->writeMessage(msg) );
+    // Send data.
+    QVERIFY( m_monitor->writeMessage(m_monitorCodec.serialize(data)) );
     QApplication::processEvents();
 
     qSleep(waitMsClipboard);
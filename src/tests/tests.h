@@ -20,12 +20,15 @@
 #ifndef TESTS_H
 #define TESTS_H
 
+#include "common/mimedatacodec.h"
+
 #include <QObject>
 #include <QStringList>
 
 class RemoteProcess;
 class QProcess;
 class QByteArray;
+class QMimeData;
 
 /**
  * Tests for the application.
@@ -44,15 +47,26 @@ private slots:
     void cleanup();
 
     void clipboardToItem();
+    void clipboardToItemAgain();
+    void largeClipboardToItem();
+    void sharedMemoryRelease();
     void itemToClipboard();
     void tabAddRemove();
     void action();
+    void actionOutput();
     void insertRemoveItems();
     void renameTab();
     void importExportTab();
+    void importExportJson();
     void separator();
     void eval();
+    void byteArrayViews();
     void rawData();
+    void session();
+    void globalState();
+    void commandsPerSecond();
+    void evalPerSecond();
+    void commandMatcher();
 
 private:
     bool startServer();
@@ -61,9 +75,11 @@ private:
 
     /** Set clipboard through monitor process. */
     void setClipboard(const QByteArray &bytes, const QString &mime = QString("text/plain"));
+    void setClipboard(const QMimeData &data);
 
     QProcess *m_server;
     RemoteProcess *m_monitor;
+    MimeDataCodec m_monitorCodec;
 };
 
 #endif // TESTS_H